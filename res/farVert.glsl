@@ -0,0 +1,32 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec3 aColor;
+
+#define NUM_CASCADES 3 // isto kot m_numCascades v VoxelRenderer.cpp
+
+layout (std140) uniform FrameData
+{
+    mat4 uViewProj;
+    mat4 uShadowViewProj[NUM_CASCADES];
+    vec4 uShadowAtlasRects[NUM_CASCADES]; // xy = zamik, zw = velikost (v uv atlasa)
+    vec3 uCameraPos;
+    float uFogEnd;
+};
+
+// visinsko polje za mrezo chunkov (FarTerrain), pozicije so ze v svetu
+// uporablja isti frag.glsl kot chunki
+
+out vec3 FragCoord;
+out vec3 Normal;
+out vec3 Color;
+
+void main()
+{
+    FragCoord = aPos;
+    Normal = aNormal;
+    Color = aColor;
+
+    gl_Position = uViewProj * vec4(aPos, 1.0);
+}
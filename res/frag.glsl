@@ -5,9 +5,18 @@ out vec4 FragColor;
 in vec3 FragCoord;
 in vec3 Normal;
 in vec3 Color;
-in vec4 FragShadowCoord;
 
-uniform vec3 uCameraPos;
+#define NUM_CASCADES 3 // isto kot m_numCascades v VoxelRenderer.cpp
+#define SHADOW_DISTANCE 20.0 // isto kot zadnji m_cascadeSplits v VoxelRenderer.cpp
+
+layout (std140) uniform FrameData
+{
+    mat4 uViewProj;
+    mat4 uShadowViewProj[NUM_CASCADES];
+    vec4 uShadowAtlasRects[NUM_CASCADES]; // xy = zamik, zw = velikost (v uv atlasa)
+    vec3 uCameraPos;
+    float uFogEnd;
+};
 uniform sampler2D uShadowMap;
 
 const vec3 lightDir = normalize(vec3(0.5, -1.5, -0.7));
@@ -22,31 +31,49 @@ vec3 CalculateFog(vec3 color)
     //float visibility = 1.0 / exp(pow(dist * fogDensity, 2.0));
 
     float dist = distance(FragCoord, uCameraPos);
-    float fog = smoothstep(17.0, 20.0, dist);
+    float fog = smoothstep(uFogEnd * 0.85, uFogEnd, dist);
     return mix(color, fogColor, fog);
 }
 
 float CalculateShadow()
 {
-    vec3 pos = FragShadowCoord.xyz / FragShadowCoord.w;
-    pos = (pos + 1.0) / 2.0;
-
-    if (pos.x < 0.0 || pos.x > 1.0 || pos.y < 0.0 || pos.y > 1.0)
+    // najbolj podroben cascade, v katerega pade fragment
+    int cascade = -1;
+    vec3 pos;
+
+    for (int i = 0; i < NUM_CASCADES; i++)
+    {
+        vec4 shadowCoord = uShadowViewProj[i] * vec4(FragCoord, 1.0);
+        pos = (shadowCoord.xyz / shadowCoord.w + 1.0) / 2.0;
+
+        if (pos.x >= 0.0 && pos.x <= 1.0 && pos.y >= 0.0 && pos.y <= 1.0 && pos.z <= 1.0)
+        {
+            cascade = i;
+            break;
+        }
+    }
+
+    if (cascade == -1)
         return 1.0;
 
     //  b   c
     //    a
     //  d   e
 
-    // texelSize tukaj float ampak ce ne bi bil kvadraten texture bi bil vec2
-    //float texelSize = 1.0 / textureSize(uShadowMap, 0).x;
-    const float texelSize = 1.0 / 8192.0;
+    // atlas ni kvadraten, zato je texelSize vec2
+    vec2 texelSize = 1.0 / vec2(textureSize(uShadowMap, 0));
 
-    float a = texture(uShadowMap, pos.xy + vec2(0.0, 0.0)).r;
-    float b = texture(uShadowMap, pos.xy + vec2(-texelSize, texelSize)).r;
-    float c = texture(uShadowMap, pos.xy + vec2(texelSize, texelSize)).r;
-    float d = texture(uShadowMap, pos.xy + vec2(-texelSize, -texelSize)).r;
-    float e = texture(uShadowMap, pos.xy + vec2(texelSize, -texelSize)).r;
+    // uv v atlasu, vzorci ne smejo zaiti v sosednji cascade
+    vec4 rect = uShadowAtlasRects[cascade];
+    vec2 uv = rect.xy + pos.xy * rect.zw;
+    vec2 minUv = rect.xy + texelSize;
+    vec2 maxUv = rect.xy + rect.zw - texelSize;
+
+    float a = texture(uShadowMap, clamp(uv + vec2(0.0, 0.0), minUv, maxUv)).r;
+    float b = texture(uShadowMap, clamp(uv + vec2(-texelSize.x, texelSize.y), minUv, maxUv)).r;
+    float c = texture(uShadowMap, clamp(uv + vec2(texelSize.x, texelSize.y), minUv, maxUv)).r;
+    float d = texture(uShadowMap, clamp(uv + vec2(-texelSize.x, -texelSize.y), minUv, maxUv)).r;
+    float e = texture(uShadowMap, clamp(uv + vec2(texelSize.x, -texelSize.y), minUv, maxUv)).r;
 
     float shadow = 1.0;
     float depth = pos.z;
@@ -64,7 +91,9 @@ float CalculateShadow()
     if (e < depth - shadowBias)
         shadow -= 0.1;
 
-    return shadow;
+    // megla je dlje od senc, zato sence proti koncu zadnjega cascada zbledijo, da ni vidnega roba
+    float dist = distance(FragCoord, uCameraPos);
+    return mix(shadow, 1.0, smoothstep(SHADOW_DISTANCE * 0.7, SHADOW_DISTANCE * 0.95, dist));
 
     /*
     float shadowDepth = texture(uShadowMap, pos.xy).r;
@@ -1,13 +1,27 @@
 #version 330 core
 
+// depth mesh ima samo pozicije
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in uint aNormal;
-layout (location = 2) in uvec3 aColor;
+layout (location = 3) in uint aSlot; // pozicija chunka v uChunkPositions (0 = brez zamika)
 
-uniform mat4 uModel;
-uniform mat4 uViewProj;
+#define NUM_CASCADES 3 // isto kot m_numCascades v VoxelRenderer.cpp
+
+layout (std140) uniform FrameData
+{
+    mat4 uViewProj;
+    mat4 uShadowViewProj[NUM_CASCADES];
+    vec4 uShadowAtlasRects[NUM_CASCADES]; // xy = zamik, zw = velikost (v uv atlasa)
+    vec3 uCameraPos;
+    float uFogEnd;
+};
+
+uniform vec4 uModel; // xyz = zamik, w = skala
+uniform samplerBuffer uChunkPositions;
+uniform int uCascade; // -1 = kamera (depth prepass)
 
 void main()
 {
-    gl_Position = uViewProj * uModel * vec4(aPos, 1.0);
+    vec3 pos = aPos * uModel.w + uModel.xyz + texelFetch(uChunkPositions, int(aSlot)).xyz;
+    mat4 viewProj = uCascade < 0 ? uViewProj : uShadowViewProj[uCascade];
+    gl_Position = viewProj * vec4(pos, 1.0);
 }
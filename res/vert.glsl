@@ -3,17 +3,25 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in uint aNormal;
 layout (location = 2) in uvec3 aColor;
+layout (location = 3) in uint aSlot; // pozicija chunka v uChunkPositions (0 = brez zamika)
 
-uniform mat4 uModel;
-uniform mat4 uViewProj;
-uniform mat3 uNormalMat;
+#define NUM_CASCADES 3 // isto kot m_numCascades v VoxelRenderer.cpp
 
-uniform mat4 uShadowViewProj;
+layout (std140) uniform FrameData
+{
+    mat4 uViewProj;
+    mat4 uShadowViewProj[NUM_CASCADES];
+    vec4 uShadowAtlasRects[NUM_CASCADES]; // xy = zamik, zw = velikost (v uv atlasa)
+    vec3 uCameraPos;
+    float uFogEnd;
+};
+
+uniform vec4 uModel; // xyz = zamik, w = skala
+uniform samplerBuffer uChunkPositions;
 
 out vec3 FragCoord;
 out vec3 Normal;
 out vec3 Color;
-out vec4 FragShadowCoord;
 
 void main()
 {
@@ -29,10 +37,11 @@ void main()
     case 5u: normal = vec3(0, 0, 1); break;
     }
 
-    FragCoord = (uModel * vec4(aPos, 1.0)).xyz;
-    Normal = uNormalMat * normal;
+    vec3 pos = aPos * uModel.w + uModel.xyz + texelFetch(uChunkPositions, int(aSlot)).xyz;
+
+    FragCoord = pos;
+    Normal = normal; // samo zamik in enakomerna skala, normale ostanejo iste
     Color = aColor / 255.0f;
-    FragShadowCoord = uShadowViewProj * vec4(FragCoord, 1.0);
 
-    gl_Position = uViewProj * uModel * vec4(aPos, 1.0);
+    gl_Position = uViewProj * vec4(pos, 1.0);
 }
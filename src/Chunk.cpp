@@ -1,58 +1,200 @@
 #include "Chunk.h"
 #include "VoxelRenderer.h"
+#include "FuncTimer.h"
 #include <vector>
 #include <glm/common.hpp>
 #include <chrono>
 #include <iostream>
 
-struct Vertex
-{
-    glm::vec3 pos;
-    uint8_t normal; // samo indeks
-    glm::u8vec3 color; // 3 bytes
-};
-
 constexpr auto r = 1.0f / 16.0f / 2.0f;
 
 namespace voxr
 {
+    // vao in vbo se ustvarita sele v UploadMesh, da lahko chunk naredimo tudi na drugi niti
     Chunk::Chunk()
     {
-        glGenVertexArrays(1, &m_vao);
-        glBindVertexArray(m_vao);
-
-        glGenBuffers(1, &m_vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
-        glEnableVertexAttribArray(1);
-        glVertexAttribIPointer(1, 1, GL_UNSIGNED_BYTE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-        glEnableVertexAttribArray(2);
-        glVertexAttribIPointer(2, 3, GL_UNSIGNED_BYTE, sizeof(Vertex), (void*)offsetof(Vertex, color));
-
         m_voxels = new Voxel[width * width * width];
         assert(m_voxels != nullptr && "Failed to allocate voxels for a chunk!");
+
+        // dokler mesh ni zgrajen, so vse ploskve povezane in chunk je poln
+        memset(m_sectionConnections, 0x3f, sizeof(m_sectionConnections));
+        SetBoundsFull();
     }
 
     Chunk::~Chunk()
     {
-        glDeleteVertexArrays(1, &m_vao);
-        glDeleteBuffers(1, &m_vbo);
+        if (m_vao != 0)
+        {
+            glDeleteVertexArrays(1, &m_vao);
+            glDeleteBuffers(1, &m_vbo);
+        }
+
+        if (m_depthVao != 0)
+        {
+            glDeleteVertexArrays(1, &m_depthVao);
+            glDeleteBuffers(1, &m_depthVbo);
+        }
+
+        VertexArena::Free(VertexArena::Stream::Color, m_arenaRange);
+        VertexArena::Free(VertexArena::Stream::Depth, m_depthArenaRange);
+        VertexArena::FreeSlot(m_slot);
+
+        // senca chunka mora izginiti iz shadow mapa
+        if (m_numVertices != 0)
+            InvalidateShadows(m_pos - worldWidth / 2.0f, m_pos + worldWidth / 2.0f);
 
         delete[] m_voxels;
     }
 
-    void AddFaceBottom(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color)
+    void Chunk::SetPosition(const glm::vec3& pos)
+    {
+        // slot v areni ima shranjeno pozicijo
+        if (m_slot != 0 && pos != m_pos)
+            VertexArena::SetSlotPosition(m_slot, pos);
+
+        m_pos = pos;
+        m_boundsChanged = true;
+    }
+
+    int Chunk::GetMinHeight() const
+    {
+        if (m_heightRangeDirty)
+            UpdateHeightRange();
+        return m_minHeight;
+    }
+
+    int Chunk::GetMaxHeight() const
+    {
+        if (m_heightRangeDirty)
+            UpdateHeightRange();
+        return m_maxHeight;
+    }
+
+    glm::vec3 Chunk::VoxelToWorld(const glm::ivec3& corner) const
+    {
+        // centri voxlov so na (i - width / 2) / 16, ploskve pol voxla stran
+        constexpr float voxelSize = 1.0f / 16.0f;
+        return m_pos + (glm::vec3(corner) - width / 2.0f) * voxelSize - voxelSize / 2.0f;
+    }
+
+    void Chunk::PadToLodCells(glm::ivec3* min, glm::ivec3* max) const
+    {
+        // celica loda je poravnana na 2^lod voxlov in je polna, ce je vecina njenih voxlov polnih
+        int cell = 1 << m_lod;
+        *min = (*min / cell) * cell;
+        *max = ((*max + cell - 1) / cell) * cell;
+    }
+
+    void Chunk::GetBounds(glm::vec3* outMin, glm::vec3* outMax) const
+    {
+        glm::ivec3 min, max;
+        if (GetVoxelBounds(&min, &max))
+            PadToLodCells(&min, &max);
+        else
+            min = max = glm::ivec3(width / 2, 0, width / 2);
+
+        *outMin = VoxelToWorld(min);
+        *outMax = VoxelToWorld(max);
+    }
+
+    bool Chunk::GetSectionBounds(int section, glm::vec3* outMin, glm::vec3* outMax) const
+    {
+        if (IsSectionEmpty(section))
+            return false;
+
+        glm::ivec3 min = m_sectionBoundsMin[section];
+        glm::ivec3 max = m_sectionBoundsMax[section];
+        PadToLodCells(&min, &max);
+
+        *outMin = VoxelToWorld(min);
+        *outMax = VoxelToWorld(max);
+        return true;
+    }
+
+    bool Chunk::GetVoxelBounds(glm::ivec3* outMin, glm::ivec3* outMax) const
+    {
+        *outMin = glm::ivec3(width);
+        *outMax = glm::ivec3(0);
+
+        for (int section = 0; section < numSections; section++)
+        {
+            if (IsSectionEmpty(section))
+                continue;
+
+            *outMin = glm::min(*outMin, m_sectionBoundsMin[section]);
+            *outMax = glm::max(*outMax, m_sectionBoundsMax[section]);
+        }
+
+        return outMin->x < outMax->x;
+    }
+
+    bool Chunk::IsEmpty() const
+    {
+        for (int section = 0; section < numSections; section++)
+            if (!IsSectionEmpty(section))
+                return false;
+
+        return true;
+    }
+
+    void Chunk::SetBoundsEmpty()
+    {
+        for (int section = 0; section < numSections; section++)
+        {
+            m_sectionBoundsMin[section] = glm::ivec3(width);
+            m_sectionBoundsMax[section] = glm::ivec3(0);
+        }
+
+        m_boundsChanged = true;
+    }
+
+    void Chunk::SetBoundsFull()
+    {
+        for (int section = 0; section < numSections; section++)
+        {
+            m_sectionBoundsMin[section] = glm::ivec3(0, section * sectionHeight, 0);
+            m_sectionBoundsMax[section] = glm::ivec3(width, (section + 1) * sectionHeight, width);
+        }
+
+        m_boundsChanged = true;
+    }
+
+    void Chunk::UpdateHeightRange() const
+    {
+        m_minHeight = width;
+        m_maxHeight = 0;
+
+        for (int i = 0; i < width * width; i++)
+        {
+            m_minHeight = glm::min(m_minHeight, (int)m_heightmap[i]);
+            m_maxHeight = glm::max(m_maxHeight, (int)m_heightmap[i]);
+        }
+
+        m_heightRangeDirty = false;
+    }
+
+    void Chunk::RebuildHeightmap()
+    {
+        for (int z = 0; z < width; z++)
+            for (int x = 0; x < width; x++)
+                m_heightmap[x + z * width] = (uint8_t)FindColumnHeight(x, z, width);
+
+        UpdateHeightRange();
+
+        // voxli niso sli cez SetVoxel, tesen aabb bo izracunal BuildMesh
+        SetBoundsFull();
+    }
+
+    void AddFaceBottom(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color, float h = r)
     {
         Vertex v1;
-        v1.pos = center + glm::vec3(-r, -r, -r);
+        v1.pos = center + glm::vec3(-h, -h, -h);
         Vertex v2;
-        v2.pos = center + glm::vec3(r, -r, -r);
+        v2.pos = center + glm::vec3(h, -h, -h);
         Vertex v3;
-        v3.pos = center + glm::vec3(r, -r, r);
+        v3.pos = center + glm::vec3(h, -h, h);
         Vertex v4;
-        v4.pos = center + glm::vec3(-r, -r, r);
+        v4.pos = center + glm::vec3(-h, -h, h);
 
         //v1.normal = v2.normal = v3.normal = v4.normal = glm::vec3(0, -1, 0);
         v1.normal = v2.normal = v3.normal = v4.normal = 2;
@@ -67,16 +209,16 @@ namespace voxr
         vertices.push_back(v1);
     }
     
-    void AddFaceTop(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color)
+    void AddFaceTop(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color, float h = r)
     {
         Vertex v1;
-        v1.pos = center + glm::vec3(-r, r, -r);
+        v1.pos = center + glm::vec3(-h, h, -h);
         Vertex v2;
-        v2.pos = center + glm::vec3(r, r, -r);
+        v2.pos = center + glm::vec3(h, h, -h);
         Vertex v3;
-        v3.pos = center + glm::vec3(r, r, r);
+        v3.pos = center + glm::vec3(h, h, h);
         Vertex v4;
-        v4.pos = center + glm::vec3(-r, r, r);
+        v4.pos = center + glm::vec3(-h, h, h);
 
         //v1.normal = v2.normal = v3.normal = v4.normal = glm::vec3(0, 1, 0);
         v1.normal = v2.normal = v3.normal = v4.normal = 3;
@@ -91,16 +233,16 @@ namespace voxr
         vertices.push_back(v3);
     }
     
-    void AddFaceLeft(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color)
+    void AddFaceLeft(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color, float h = r)
     {
         Vertex v1;
-        v1.pos = center + glm::vec3(-r, -r, -r);
+        v1.pos = center + glm::vec3(-h, -h, -h);
         Vertex v2;
-        v2.pos = center + glm::vec3(-r, -r, r);
+        v2.pos = center + glm::vec3(-h, -h, h);
         Vertex v3;
-        v3.pos = center + glm::vec3(-r, r, r);
+        v3.pos = center + glm::vec3(-h, h, h);
         Vertex v4;
-        v4.pos = center + glm::vec3(-r, r, -r);
+        v4.pos = center + glm::vec3(-h, h, -h);
 
         //v1.normal = v2.normal = v3.normal = v4.normal = glm::vec3(-1, 0, 0);
         v1.normal = v2.normal = v3.normal = v4.normal = 0;
@@ -115,16 +257,16 @@ namespace voxr
         vertices.push_back(v1);
     }
 
-    void AddFaceRight(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color)
+    void AddFaceRight(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color, float h = r)
     {
         Vertex v1;
-        v1.pos = center + glm::vec3(r, -r, -r);
+        v1.pos = center + glm::vec3(h, -h, -h);
         Vertex v2;
-        v2.pos = center + glm::vec3(r, -r, r);
+        v2.pos = center + glm::vec3(h, -h, h);
         Vertex v3;
-        v3.pos = center + glm::vec3(r, r, r);
+        v3.pos = center + glm::vec3(h, h, h);
         Vertex v4;
-        v4.pos = center + glm::vec3(r, r, -r);
+        v4.pos = center + glm::vec3(h, h, -h);
 
         //v1.normal = v2.normal = v3.normal = v4.normal = glm::vec3(1, 0, 0);
         v1.normal = v2.normal = v3.normal = v4.normal = 1;
@@ -139,16 +281,16 @@ namespace voxr
         vertices.push_back(v3);
     }
 
-    void AddFaceFront(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color)
+    void AddFaceFront(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color, float h = r)
     {
         Vertex v1;
-        v1.pos = center + glm::vec3(-r, -r, r);
+        v1.pos = center + glm::vec3(-h, -h, h);
         Vertex v2;
-        v2.pos = center + glm::vec3(r, -r, r);
+        v2.pos = center + glm::vec3(h, -h, h);
         Vertex v3;
-        v3.pos = center + glm::vec3(r, r, r);
+        v3.pos = center + glm::vec3(h, h, h);
         Vertex v4;
-        v4.pos = center + glm::vec3(-r, r, r);
+        v4.pos = center + glm::vec3(-h, h, h);
 
         //v1.normal = v2.normal = v3.normal = v4.normal = glm::vec3(0, 0, 1);
         v1.normal = v2.normal = v3.normal = v4.normal = 5;
@@ -163,16 +305,16 @@ namespace voxr
         vertices.push_back(v1);
     }
 
-    void AddFaceBack(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color)
+    void AddFaceBack(const glm::vec3& center, std::vector<Vertex>& vertices, const glm::vec3& color, float h = r)
     {
         Vertex v1;
-        v1.pos = center + glm::vec3(-r, -r, -r);
+        v1.pos = center + glm::vec3(-h, -h, -h);
         Vertex v2;
-        v2.pos = center + glm::vec3(r, -r, -r);
+        v2.pos = center + glm::vec3(h, -h, -h);
         Vertex v3;
-        v3.pos = center + glm::vec3(r, r, -r);
+        v3.pos = center + glm::vec3(h, h, -h);
         Vertex v4;
-        v4.pos = center + glm::vec3(-r, r, -r);
+        v4.pos = center + glm::vec3(-h, h, -h);
 
         //v1.normal = v2.normal = v3.normal = v4.normal = glm::vec3(0, 0, -1);
         v1.normal = v2.normal = v3.normal = v4.normal = 4;
@@ -187,12 +329,67 @@ namespace voxr
         vertices.push_back(v3);
     }
 
+    glm::u8vec3 GetVoxelColor(Voxel voxel, float frand)
+    {
+        glm::u8vec3 color;
+
+        if (voxel == Voxel::Grass)
+        {
+            constexpr glm::vec3 colorA = glm::vec3(216, 245, 86);
+            constexpr glm::vec3 colorB = glm::vec3(50, 191, 13);
+            color = glm::mix(colorA, colorB, frand);
+        }
+        else if (voxel == Voxel::Sand)
+        {
+            constexpr glm::vec3 colorA = glm::vec3(247, 227, 7);
+            constexpr glm::vec3 colorB = glm::vec3(255, 242, 97);
+            color = glm::mix(colorA, colorB, frand);
+        }
+        else if (voxel == Voxel::Water)
+        {
+            constexpr glm::vec3 colorA = glm::vec3(37, 162, 245);
+            constexpr glm::vec3 colorB = glm::vec3(26, 130, 199);
+            color = glm::mix(colorA, colorB, frand);
+        }
+        else if (voxel == Voxel::Wood)
+        {
+            constexpr glm::vec3 colorA = glm::vec3(138, 79, 10);
+            constexpr glm::vec3 colorB = glm::vec3(105, 58, 2);
+            color = glm::mix(colorA, colorB, frand);
+        }
+        else if (voxel == Voxel::Leaf)
+        {
+            constexpr glm::vec3 colorA = glm::vec3(29, 173, 69);
+            constexpr glm::vec3 colorB = glm::vec3(14, 227, 72);
+            color = glm::mix(colorA, colorB, frand);
+        }
+
+        return color;
+    }
+
     void Chunk::GenerateMesh()
     {
-        std::vector<Vertex> vertices;
+        BuildMesh();
+        UploadMesh();
+    }
+
+    void Chunk::BuildMesh()
+    {
+        TIME_FUNCTION("BuildMesh");
+
+        m_meshDirty = false;
+
+        std::vector<Vertex>& vertices = m_vertices;
+        vertices.clear();
         vertices.reserve(m_numVertices + 36);
 
-        srand(69u);
+        // svoj generator namesto srand/rand, ker rand ni varen za vec niti
+        uint32_t randState = 69u;
+
+        // ploskve sekcije zberemo po smereh (indeks normale), da se lahko cele smeri preskocijo pri risanju
+        std::vector<Vertex> faceVertices[6];
+
+        SetBoundsEmpty();
 
         for (int y = width - 1; y >= 0; y--)
         {
@@ -200,79 +397,444 @@ namespace voxr
             {
                 for (int x = 0; x < width; x++)
                 {
-                    float frand = (float)rand() / RAND_MAX;
+                    randState = randState * 1664525u + 1013904223u;
+                    float frand = (randState >> 8) / 16777216.0f;
 
                     voxr::Voxel voxel = GetVoxel(x, y, z);
 
                     if (voxel == Voxel::Air)
                         continue;
 
+                    GrowBounds(x, y, z);
+
                     glm::vec3 center = {
                         (x - width / 2.0f) * 1.0f / 16.0f,
                         (y - width / 2.0f) * 1.0f / 16.0f,
                         (z - width / 2.0f) * 1.0f / 16.0f
                     };
 
-                    glm::u8vec3 color;
-
-                    if (voxel == Voxel::Grass)
-                    {
-                        constexpr glm::vec3 colorA = glm::vec3(216, 245, 86);
-                        constexpr glm::vec3 colorB = glm::vec3(50, 191, 13);
-                        color = glm::mix(colorA, colorB, frand);
-                    }
-                    else if (voxel == Voxel::Sand)
-                    {
-                        constexpr glm::vec3 colorA = glm::vec3(247, 227, 7);
-                        constexpr glm::vec3 colorB = glm::vec3(255, 242, 97);
-                        color = glm::mix(colorA, colorB, frand);
-                    }
-                    else if (voxel == Voxel::Water)
-                    {
-                        constexpr glm::vec3 colorA = glm::vec3(37, 162, 245);
-                        constexpr glm::vec3 colorB = glm::vec3(26, 130, 199);
-                        color = glm::mix(colorA, colorB, frand);
-                    }
-                    else if (voxel == Voxel::Wood)
-                    {
-                        constexpr glm::vec3 colorA = glm::vec3(138, 79, 10);
-                        constexpr glm::vec3 colorB = glm::vec3(105, 58, 2);
-                        color = glm::mix(colorA, colorB, frand);
-                    }
-                    else if (voxel == Voxel::Leaf)
-                    {
-                        constexpr glm::vec3 colorA = glm::vec3(29, 173, 69);
-                        constexpr glm::vec3 colorB = glm::vec3(14, 227, 72);
-                        color = glm::mix(colorA, colorB, frand);
-                    }
-                    
+                    glm::u8vec3 color = GetVoxelColor(voxel, frand);
 
                     if (y == 0 || GetVoxel(x, y - 1, z) == Voxel::Air)
-                        AddFaceBottom(center, vertices, color);
+                        AddFaceBottom(center, faceVertices[2], color);
 
                     if (y == width - 1 || GetVoxel(x, y + 1, z) == Voxel::Air)
-                        AddFaceTop(center, vertices, color);
+                        AddFaceTop(center, faceVertices[3], color);
 
                     if (x == 0 || GetVoxel(x - 1, y, z) == Voxel::Air)
-                        AddFaceLeft(center, vertices, color);
+                        AddFaceLeft(center, faceVertices[0], color);
 
                     if (x == width - 1 || GetVoxel(x + 1, y, z) == Voxel::Air)
-                        AddFaceRight(center, vertices, color);
+                        AddFaceRight(center, faceVertices[1], color);
 
                     if (z == width - 1 || GetVoxel(x, y, z + 1) == Voxel::Air)
-                        AddFaceFront(center, vertices, color);
+                        AddFaceFront(center, faceVertices[5], color);
 
                     if (z == 0 || GetVoxel(x, y, z - 1) == Voxel::Air)
-                        AddFaceBack(center, vertices, color);
+                        AddFaceBack(center, faceVertices[4], color);
+                }
+            }
+
+            // sekcije so v meshu ena za drugo, od zgornje proti spodnji, v vsaki pa smeri od 0 do 5
+            if (y % sectionHeight == 0)
+            {
+                for (int face = 0; face < 6; face++)
+                {
+                    VertexArena::Range& range = m_faceRanges[y / sectionHeight * 6 + face];
+                    range.first = (uint32_t)vertices.size();
+                    range.count = (uint32_t)faceVertices[face].size();
+
+                    vertices.insert(vertices.end(), faceVertices[face].begin(), faceVertices[face].end());
+                    faceVertices[face].clear();
+                }
+            }
+        }
+
+        // manjsi lod meshi so v istem bufferju za polnim
+        m_lodRanges[0] = { 0, (uint32_t)vertices.size() };
+
+        for (int lod = 1; lod < numLods; lod++)
+        {
+            m_lodRanges[lod].first = (uint32_t)vertices.size();
+            BuildLodMesh(lod, vertices);
+            m_lodRanges[lod].count = (uint32_t)vertices.size() - m_lodRanges[lod].first;
+        }
+
+        BuildDepthMesh();
+        BuildOccluder();
+        BuildConnectivity();
+    }
+
+    // voxli se zdruzijo v celice velikosti 2^lod, celica je polna ce je vsaj pol voxlov polnih,
+    // tip pa je najpogostejsi med polnimi. ploskve na robu chunka se vedno dodajo, zato
+    // delujejo kot skirti proti sosedom z drugim lod-om
+    void Chunk::BuildLodMesh(int lod, std::vector<Vertex>& vertices)
+    {
+        constexpr int numVoxelTypes = (int)Voxel::Leaf + 1;
+
+        const int size = 1 << lod;
+        const int cells = width / size;
+        const int cellVoxels = size * size * size;
+
+        std::vector<Voxel> grid(cells * cells * cells);
+
+        for (int cz = 0; cz < cells; cz++)
+        {
+            for (int cy = 0; cy < cells; cy++)
+            {
+                for (int cx = 0; cx < cells; cx++)
+                {
+                    int counts[numVoxelTypes] = {};
+
+                    for (int z = cz * size; z < (cz + 1) * size; z++)
+                        for (int y = cy * size; y < (cy + 1) * size; y++)
+                            for (int x = cx * size; x < (cx + 1) * size; x++)
+                                counts[(int)GetVoxel(x, y, z)]++;
+
+                    Voxel voxel = Voxel::Air;
+
+                    if ((cellVoxels - counts[0]) * 2 >= cellVoxels)
+                    {
+                        int best = 1;
+                        for (int type = 2; type < numVoxelTypes; type++)
+                            if (counts[type] > counts[best])
+                                best = type;
+
+                        voxel = (Voxel)best;
+                    }
+
+                    grid[cx + cy * cells + cz * cells * cells] = voxel;
+                }
+            }
+        }
+
+        auto cell = [&](int x, int y, int z) { return grid[x + y * cells + z * cells * cells]; };
+
+        uint32_t randState = 69u;
+        float h = r * size;
+
+        for (int cz = 0; cz < cells; cz++)
+        {
+            for (int cy = 0; cy < cells; cy++)
+            {
+                for (int cx = 0; cx < cells; cx++)
+                {
+                    randState = randState * 1664525u + 1013904223u;
+                    float frand = (randState >> 8) / 16777216.0f;
+
+                    Voxel voxel = cell(cx, cy, cz);
+                    if (voxel == Voxel::Air)
+                        continue;
+
+                    // celica pokrije iste voxle kot v polnem meshu
+                    glm::vec3 center = (glm::vec3(cx, cy, cz) * (float)size + (size - 1) / 2.0f - width / 2.0f) / 16.0f;
+                    glm::u8vec3 color = GetVoxelColor(voxel, frand);
+
+                    if (cy == 0 || cell(cx, cy - 1, cz) == Voxel::Air)
+                        AddFaceBottom(center, vertices, color, h);
+
+                    if (cy == cells - 1 || cell(cx, cy + 1, cz) == Voxel::Air)
+                        AddFaceTop(center, vertices, color, h);
+
+                    if (cx == 0 || cell(cx - 1, cy, cz) == Voxel::Air)
+                        AddFaceLeft(center, vertices, color, h);
+
+                    if (cx == cells - 1 || cell(cx + 1, cy, cz) == Voxel::Air)
+                        AddFaceRight(center, vertices, color, h);
+
+                    if (cz == cells - 1 || cell(cx, cy, cz + 1) == Voxel::Air)
+                        AddFaceFront(center, vertices, color, h);
+
+                    if (cz == 0 || cell(cx, cy, cz - 1) == Voxel::Air)
+                        AddFaceBack(center, vertices, color, h);
+                }
+            }
+        }
+    }
+
+    // flood fill zraka v vsaki sekciji: ploskve, ki jih doseze isto obmocje, so povezane
+    void Chunk::BuildConnectivity()
+    {
+        constexpr int sectionVoxels = width * sectionHeight * width;
+
+        std::vector<bool> visited(sectionVoxels);
+        std::vector<int> stack;
+
+        for (int section = 0; section < numSections; section++)
+        {
+            uint8_t* connections = &m_sectionConnections[section * 6];
+            memset(connections, 0, 6);
+
+            int y0 = section * sectionHeight;
+            std::fill(visited.begin(), visited.end(), false);
+
+            for (int start = 0; start < sectionVoxels; start++)
+            {
+                if (visited[start])
+                    continue;
+
+                // indeks v sekciji: x + ly * width + z * width * sectionHeight
+                auto isAir = [&](int i) {
+                    return GetVoxel(i % width, y0 + (i / width) % sectionHeight, i / (width * sectionHeight)) == Voxel::Air;
+                };
+
+                visited[start] = true;
+                if (!isAir(start))
+                    continue;
+
+                uint8_t faces = 0;
+                stack.push_back(start);
+
+                while (stack.empty() == false)
+                {
+                    int i = stack.back();
+                    stack.pop_back();
+
+                    int x = i % width;
+                    int ly = (i / width) % sectionHeight;
+                    int z = i / (width * sectionHeight);
+
+                    if (x == 0) faces |= 1 << 0;
+                    if (x == width - 1) faces |= 1 << 1;
+                    if (ly == 0) faces |= 1 << 2;
+                    if (ly == sectionHeight - 1) faces |= 1 << 3;
+                    if (z == 0) faces |= 1 << 4;
+                    if (z == width - 1) faces |= 1 << 5;
+
+                    auto visit = [&](int n) {
+                        if (visited[n] == false)
+                        {
+                            visited[n] = true;
+                            if (isAir(n))
+                                stack.push_back(n);
+                        }
+                    };
+
+                    if (x > 0) visit(i - 1);
+                    if (x < width - 1) visit(i + 1);
+                    if (ly > 0) visit(i - width);
+                    if (ly < sectionHeight - 1) visit(i + width);
+                    if (z > 0) visit(i - width * sectionHeight);
+                    if (z < width - 1) visit(i + width * sectionHeight);
+                }
+
+                for (int face = 0; face < 6; face++)
+                    if (faces & (1 << face))
+                        connections[face] |= faces;
+            }
+        }
+    }
+
+    void Chunk::BuildOccluder()
+    {
+        constexpr int blocks = width / occluderBlockSize;
+
+        for (int bz = 0; bz < blocks; bz++)
+        {
+            for (int bx = 0; bx < blocks; bx++)
+            {
+                int height = width;
+
+                for (int z = bz * occluderBlockSize; z < (bz + 1) * occluderBlockSize && height > 0; z++)
+                {
+                    for (int x = bx * occluderBlockSize; x < (bx + 1) * occluderBlockSize && height > 0; x++)
+                    {
+                        int y = 0;
+                        while (y < height && GetVoxel(x, y, z) != Voxel::Air)
+                            y++;
+
+                        height = y;
+                    }
+                }
+
+                m_solidHeights[bx + bz * blocks] = (uint8_t)height;
+            }
+        }
+    }
+
+    // za senco so pomembne samo pozicije, zato se ploskve ne glede na barvo
+    // zdruzijo v cim vecje pravokotnike (greedy meshing)
+    void Chunk::BuildDepthMesh()
+    {
+        std::vector<glm::vec3>& vertices = m_depthVertices;
+        vertices.clear();
+
+        bool mask[width * width];
+
+        // isti vrstni red kot indeksi normal v vert.glsl: -x, +x, -y, +y, -z, +z
+        for (int dir = 0; dir < 6; dir++)
+        {
+            int axis = dir / 2;
+            int sign = dir % 2 == 0 ? -1 : 1;
+
+            // u x v = os, da so trikotniki obrnjeni navzven
+            int u = (axis + 1) % 3;
+            int v = (axis + 2) % 3;
+
+            for (int slice = 0; slice < width; slice++)
+            {
+                int neighbor = slice + sign;
+
+                for (int j = 0; j < width; j++)
+                {
+                    for (int i = 0; i < width; i++)
+                    {
+                        glm::ivec3 p;
+                        p[axis] = slice;
+                        p[u] = i;
+                        p[v] = j;
+
+                        bool visible = GetVoxel(p.x, p.y, p.z) != Voxel::Air;
+
+                        if (visible && neighbor >= 0 && neighbor < width)
+                        {
+                            p[axis] = neighbor;
+                            visible = GetVoxel(p.x, p.y, p.z) == Voxel::Air;
+                        }
+
+                        mask[i + j * width] = visible;
+                    }
+                }
+
+                float plane = (slice - width / 2.0f) / 16.0f + sign * r;
+
+                for (int j = 0; j < width; j++)
+                {
+                    for (int i = 0; i < width;)
+                    {
+                        if (mask[i + j * width] == false)
+                        {
+                            i++;
+                            continue;
+                        }
+
+                        int w = 1;
+                        while (i + w < width && mask[i + w + j * width])
+                            w++;
+
+                        int h = 1;
+                        for (; j + h < width; h++)
+                        {
+                            bool fullRow = true;
+                            for (int k = 0; k < w && fullRow; k++)
+                                fullRow = mask[i + k + (j + h) * width];
+
+                            if (fullRow == false)
+                                break;
+                        }
+
+                        for (int dj = 0; dj < h; dj++)
+                            for (int di = 0; di < w; di++)
+                                mask[i + di + (j + dj) * width] = false;
+
+                        float u0 = (i - width / 2.0f) / 16.0f - r;
+                        float u1 = (i + w - width / 2.0f) / 16.0f - r;
+                        float v0 = (j - width / 2.0f) / 16.0f - r;
+                        float v1 = (j + h - width / 2.0f) / 16.0f - r;
+
+                        glm::vec3 p00, p10, p11, p01;
+                        p00[axis] = p10[axis] = p11[axis] = p01[axis] = plane;
+                        p00[u] = u0; p00[v] = v0;
+                        p10[u] = u1; p10[v] = v0;
+                        p11[u] = u1; p11[v] = v1;
+                        p01[u] = u0; p01[v] = v1;
+
+                        if (sign > 0)
+                        {
+                            vertices.push_back(p00);
+                            vertices.push_back(p10);
+                            vertices.push_back(p11);
+
+                            vertices.push_back(p00);
+                            vertices.push_back(p11);
+                            vertices.push_back(p01);
+                        }
+                        else
+                        {
+                            vertices.push_back(p00);
+                            vertices.push_back(p11);
+                            vertices.push_back(p10);
+
+                            vertices.push_back(p00);
+                            vertices.push_back(p01);
+                            vertices.push_back(p11);
+                        }
+
+                        i += w;
+                    }
                 }
             }
         }
+    }
+
+    void Chunk::UploadMesh()
+    {
+        TIME_FUNCTION("UploadMesh");
+
+#if USE_VERTEX_ARENA
+        if (m_slot == 0)
+            m_slot = VertexArena::AllocateSlot(m_pos);
+
+        if (m_arenaRange.count != m_vertices.size())
+        {
+            VertexArena::Free(VertexArena::Stream::Color, m_arenaRange);
+            m_arenaRange = VertexArena::Allocate(VertexArena::Stream::Color, (uint32_t)m_vertices.size());
+        }
+
+        if (m_depthArenaRange.count != m_depthVertices.size())
+        {
+            VertexArena::Free(VertexArena::Stream::Depth, m_depthArenaRange);
+            m_depthArenaRange = VertexArena::Allocate(VertexArena::Stream::Depth, (uint32_t)m_depthVertices.size());
+        }
+
+        VertexArena::Upload(m_arenaRange, m_vertices.data(), m_slot);
+        VertexArena::Upload(m_depthArenaRange, m_depthVertices.data(), m_slot);
+#else
+        if (m_vao == 0)
+        {
+            glGenVertexArrays(1, &m_vao);
+            glBindVertexArray(m_vao);
+
+            glGenBuffers(1, &m_vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
+            glEnableVertexAttribArray(1);
+            glVertexAttribIPointer(1, 1, GL_UNSIGNED_BYTE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+            glEnableVertexAttribArray(2);
+            glVertexAttribIPointer(2, 3, GL_UNSIGNED_BYTE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+        }
 
         glBindVertexArray(m_vao);
         glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), m_vertices.data(), GL_STATIC_DRAW);
+
+        if (m_depthVao == 0)
+        {
+            glGenVertexArrays(1, &m_depthVao);
+            glBindVertexArray(m_depthVao);
+
+            glGenBuffers(1, &m_depthVbo);
+            glBindBuffer(GL_ARRAY_BUFFER, m_depthVbo);
+
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        }
+
+        glBindVertexArray(m_depthVao);
+        glBindBuffer(GL_ARRAY_BUFFER, m_depthVbo);
+        glBufferData(GL_ARRAY_BUFFER, m_depthVertices.size() * sizeof(glm::vec3), m_depthVertices.data(), GL_STATIC_DRAW);
+#endif
         
-        m_numVertices = vertices.size();
+        if (m_numVertices != 0 || m_vertices.empty() == false)
+            InvalidateShadows(m_pos - worldWidth / 2.0f, m_pos + worldWidth / 2.0f);
+
+        m_numVertices = m_vertices.size();
+        m_numDepthVertices = m_depthVertices.size();
+
+        // cpu kopije ne rabimo vec
+        std::vector<Vertex>().swap(m_vertices);
+        std::vector<glm::vec3>().swap(m_depthVertices);
     }
 }
-
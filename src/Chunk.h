@@ -4,7 +4,11 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <glm/vec3.hpp>
+#include <glm/fwd.hpp>
+#include <glm/common.hpp>
 #include <assert.h>
+#include <vector>
+#include "VertexArena.h"
 
 namespace voxr
 {
@@ -19,6 +23,13 @@ enum class Voxel : uint8_t
     Leaf
 };
 
+struct Vertex
+{
+    glm::vec3 pos;
+    uint8_t normal; // samo indeks
+    glm::u8vec3 color; // 3 bytes
+};
+
 class Chunk
 {
 public:
@@ -35,29 +46,195 @@ public:
     {
         AssertIndex(x, y, z);
         m_voxels[x + y * width + z * width * width] = v;
+        m_meshDirty = true;
+
+        // do naslednjega BuildMesh se bounds samo povecujejo
+        if (v != Voxel::Air)
+            GrowBounds(x, y, z);
+
+        uint8_t height = m_heightmap[x + z * width];
+        if (v != Voxel::Air && y >= height)
+            SetColumnHeight(x, z, y + 1);
+        else if (v == Voxel::Air && y == height - 1)
+            SetColumnHeight(x, z, FindColumnHeight(x, z, y));
     }
 
     inline void Clear()
     {
         memset(m_voxels, 0, width * width * width);
+        memset(m_heightmap, 0, sizeof(m_heightmap));
+        m_minHeight = m_maxHeight = 0;
+        m_heightRangeDirty = false;
+        SetBoundsEmpty();
+    }
+
+    // visina stolpca je y najvisjega polnega voxla + 1 (0 ce je stolpec prazen)
+    inline int GetColumnHeight(int x, int z) const
+    {
+        AssertIndex(x, 0, z);
+        return m_heightmap[x + z * width];
+    }
+
+    int GetMinHeight() const;
+    int GetMaxHeight() const;
+
+    // ce so voxli napisani direktno v GetData()
+    void RebuildHeightmap();
+
+    // tesen aabb geometrije v svetu (zgradi ga BuildMesh, SetVoxel ga samo povecuje)
+    // pri lod > 0 je razsirjen na celice loda, ker te segajo cez voxle
+    // prazen chunk ima aabb brez volumna na dnu chunka
+    void GetBounds(glm::vec3* outMin, glm::vec3* outMax) const;
+    bool GetSectionBounds(int section, glm::vec3* outMin, glm::vec3* outMax) const; // false ce je sekcija prazna
+    bool IsEmpty() const;
+
+    // isto v lokalnih indeksih voxlov, max je izkljucen
+    bool GetVoxelBounds(glm::ivec3* outMin, glm::ivec3* outMax) const;
+
+    // bounds ali pozicija so se spremenili (za tabelo v ChunkManager::RenderChunks)
+    inline bool HaveBoundsChanged() const { return m_boundsChanged; }
+    inline void ClearBoundsChanged() { m_boundsChanged = false; }
+
+    // trdni del chunka za occlusion culling: za vsak blok occluderBlockSize x occluderBlockSize stolpcev
+    // visina, do katere so vsi voxli v vseh stolpcih bloka polni (zgradi se v BuildMesh)
+    static constexpr int occluderBlockSize = 8;
+    inline int GetSolidHeight(int bx, int bz) const { return m_solidHeights[bx + bz * (width / occluderBlockSize)]; }
+
+    // chunk je po visini razdeljen na sekcije, mesh je urejen po sekcijah od zgoraj navzdol,
+    // znotraj sekcije pa po smeri ploskev (indeks normale)
+    // ali se iz ploskve faceA sekcije po zraku pride do ploskve faceB (indeksi kot normale v vert.glsl)
+    inline bool AreFacesConnected(int section, int faceA, int faceB) const
+    {
+        return (m_sectionConnections[section * 6 + faceA] >> faceB) & 1;
+    }
+
+    // del mesha (relativno na zacetek) s ploskvami sekcije, obrnjenimi v smer face
+    inline const VertexArena::Range& GetFaceRange(int section, int face) const { return m_faceRanges[section * 6 + face]; }
+
+    // katere sekcije se risejo ta frame (bit na sekcijo, nastavi ChunkManager::RenderChunks)
+    inline uint8_t GetVisibleSections() const { return m_visibleSections; }
+    inline void SetVisibleSections(uint8_t mask) { m_visibleSections = mask; }
+
+    // lod 0 je poln mesh, lod n ima voxle velikosti 2^n (vsi so v istem bufferju)
+    inline const VertexArena::Range& GetLodRange(int lod) const { return m_lodRanges[lod]; }
+
+    // kateri lod se rise ta frame (nastavi ChunkManager::RenderChunks)
+    inline int GetLod() const { return m_lod; }
+    inline void SetLod(int lod)
+    {
+        // bounds so odvisni od loda
+        if (lod != m_lod)
+            m_boundsChanged = true;
+        m_lod = (uint8_t)lod;
     }
 
+    // pozicija centra chunka v svetu (nastavi ChunkManager::SetChunk)
+    inline const glm::vec3& GetPosition() const { return m_pos; }
+    void SetPosition(const glm::vec3& pos);
+
     inline uint32_t GetVao() const { return m_vao; }
+    inline const VertexArena::Range& GetArenaRange() const { return m_arenaRange; }
     inline size_t GetNumVertices() const { return m_numVertices; }
+
+    // mesh samo s pozicijami za shadow pass
+    inline uint32_t GetDepthVao() const { return m_depthVao; }
+    inline const VertexArena::Range& GetDepthArenaRange() const { return m_depthArenaRange; }
+    inline size_t GetNumDepthVertices() const { return m_numDepthVertices; }
     inline voxr::Voxel* GetData() { return m_voxels; }
 
+    // SetVoxel oznaci mesh kot zastarel, ChunkManager::RemeshDirtyChunks ga nato zgradi enkrat na frame
+    inline bool IsMeshDirty() const { return m_meshDirty; }
+    inline void MarkMeshDirty() { m_meshDirty = true; }
+
+    // chunk caka v load queue-ju ChunkManagerja na generiranje (nastavi in pobrise samo ChunkManager)
+    inline bool IsQueued() const { return m_queued; }
+    inline void SetQueued(bool queued) { m_queued = queued; }
+
+    // BuildMesh + UploadMesh
     void GenerateMesh();
+    // samo cpu del, lahko se klice na drugi niti
+    void BuildMesh();
+    // opengl, samo na main niti
+    void UploadMesh();
 
     static constexpr int width = 64;
     static constexpr float worldWidth = width * 1.0f / 16.0f;
+    static constexpr int sectionHeight = 16;
+    static constexpr int numSections = width / sectionHeight;
+    static constexpr uint8_t allSections = (1 << numSections) - 1;
+    static constexpr int numLods = 3;
     
 private:
     Voxel* m_voxels;
-    uint32_t m_vao, m_vbo;
+    glm::vec3 m_pos = glm::vec3(0.0f);
+    uint32_t m_vao = 0, m_vbo = 0; // ce ni USE_VERTEX_ARENA
+    VertexArena::Range m_arenaRange; // ce je USE_VERTEX_ARENA
+    uint16_t m_slot = 0;
     size_t m_numVertices = 0;
+    bool m_meshDirty = false;
+    bool m_queued = false;
+    std::vector<Vertex> m_vertices; // zgrajen mesh, ki se ni bil uploadan
+
+    uint32_t m_depthVao = 0, m_depthVbo = 0; // ce ni USE_VERTEX_ARENA
+    VertexArena::Range m_depthArenaRange; // ce je USE_VERTEX_ARENA
+    size_t m_numDepthVertices = 0;
+    std::vector<glm::vec3> m_depthVertices;
+
+    uint8_t m_heightmap[width * width] = {};
+    mutable int m_minHeight = 0, m_maxHeight = 0; // izracuna se lenobno
+    mutable bool m_heightRangeDirty = false;
+
+    uint8_t m_solidHeights[(width / occluderBlockSize) * (width / occluderBlockSize)] = {};
+
+    // prazna sekcija ima min > max
+    glm::ivec3 m_sectionBoundsMin[numSections];
+    glm::ivec3 m_sectionBoundsMax[numSections];
+    bool m_boundsChanged = true;
+
+    uint8_t m_sectionConnections[numSections * 6]; // bit faceB v bajtu faceA
+    VertexArena::Range m_faceRanges[numSections * 6];
+    uint8_t m_visibleSections = allSections;
+
+    VertexArena::Range m_lodRanges[numLods];
+    uint8_t m_lod = 0;
 
 
 private:
+    inline void SetColumnHeight(int x, int z, int height)
+    {
+        m_heightmap[x + z * width] = (uint8_t)height;
+        m_heightRangeDirty = true;
+    }
+
+    // isce prvi poln voxel od y navzdol
+    inline int FindColumnHeight(int x, int z, int y) const
+    {
+        while (y > 0 && m_voxels[x + (y - 1) * width + z * width * width] == Voxel::Air)
+            y--;
+        return y;
+    }
+
+    inline bool IsSectionEmpty(int section) const { return m_sectionBoundsMin[section].x > m_sectionBoundsMax[section].x; }
+
+    inline void GrowBounds(int x, int y, int z)
+    {
+        int section = y / sectionHeight;
+        m_sectionBoundsMin[section] = glm::min(m_sectionBoundsMin[section], glm::ivec3(x, y, z));
+        m_sectionBoundsMax[section] = glm::max(m_sectionBoundsMax[section], glm::ivec3(x + 1, y + 1, z + 1));
+        m_boundsChanged = true;
+    }
+
+    void SetBoundsEmpty();
+    void SetBoundsFull();
+    void PadToLodCells(glm::ivec3* min, glm::ivec3* max) const;
+    glm::vec3 VoxelToWorld(const glm::ivec3& corner) const; // kot voxla, ne center
+
+    void UpdateHeightRange() const;
+    void BuildDepthMesh();
+    void BuildOccluder();
+    void BuildConnectivity();
+    void BuildLodMesh(int lod, std::vector<Vertex>& vertices);
+
     void AssertIndex(int x, int y, int z) const
     {
         assert(x >= 0 && x < width && "voxel index out of bounds!");
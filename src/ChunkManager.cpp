@@ -1,5 +1,6 @@
 #include "ChunkManager.h"
 #include "VoxelRenderer.h"
+#include "Occlusion.h"
 #include "FuncTimer.h"
 #include <glm/glm.hpp>
 #include <noise/noise.h>
@@ -7,6 +8,11 @@
 #include <chrono>
 #include <iostream>
 #include <deque>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 namespace
 {
@@ -20,24 +26,272 @@ namespace
     };
     std::deque<LoadItem> m_loadQueue;
 
+    // v queue dodajamo in iz njega jemljemo samo preko teh dveh, da je Chunk::IsQueued vedno pravilen
+    void QueueChunk(voxr::Chunk* chunk, const glm::vec2& pos)
+    {
+        chunk->SetQueued(true);
+        QueueChunk(chunk, pos);
+    }
+
+    LoadItem PopQueuedChunk()
+    {
+        LoadItem item = m_loadQueue.front();
+        m_loadQueue.pop_front();
+        item.chunk->SetQueued(false);
+        return item;
+    }
+
+    // async nalaganje (LoadChunksAsync)
+    struct LoadedChunk
+    {
+        voxr::Chunk* chunk;
+        glm::ivec2 index;
+    };
+    std::thread m_loadThread;
+    std::atomic<bool> m_cancelLoad = false;
+    std::mutex m_loadedMutex;
+    std::vector<LoadedChunk> m_loadedChunks; // zgrajeni na delovnih nitih, caka na upload
+    int m_numPendingChunks = 0; // se niso uploadani
+
+    constexpr int m_uploadsPerFrame = 8;
+
+    int DistFromCenter(glm::ivec2 index)
+    {
+        constexpr int c = voxr::ChunkManager::width / 2;
+        return (index.x - c) * (index.x - c) + (index.y - c) * (index.y - c);
+    }
+
+    void UploadLoadedChunks(int maxUploads)
+    {
+        std::vector<LoadedChunk> toUpload;
+        {
+            std::lock_guard<std::mutex> lock(m_loadedMutex);
+
+            std::sort(m_loadedChunks.begin(), m_loadedChunks.end(), [](const LoadedChunk& a, const LoadedChunk& b) {
+                return DistFromCenter(a.index) < DistFromCenter(b.index);
+            });
+
+            int count = std::min(maxUploads, (int)m_loadedChunks.size());
+            toUpload.assign(m_loadedChunks.begin(), m_loadedChunks.begin() + count);
+            m_loadedChunks.erase(m_loadedChunks.begin(), m_loadedChunks.begin() + count);
+        }
+
+        for (const LoadedChunk& loaded : toUpload)
+        {
+            // zamenjamo prazen chunk, ki je bil tam med nalaganjem
+            delete voxr::ChunkManager::GetChunk(loaded.index.x, loaded.index.y);
+            voxr::ChunkManager::SetChunk(loaded.chunk, loaded.index.x, loaded.index.y);
+
+            loaded.chunk->UploadMesh();
+
+            m_numPendingChunks--;
+        }
+
+        if (m_numPendingChunks == 0 && m_loadThread.joinable())
+            m_loadThread.join();
+    }
+
+    void CancelLoadChunks()
+    {
+        if (m_loadThread.joinable())
+        {
+            m_cancelLoad = true;
+            m_loadThread.join();
+            m_cancelLoad = false;
+        }
+
+        for (const LoadedChunk& loaded : m_loadedChunks)
+            delete loaded.chunk;
+        m_loadedChunks.clear();
+
+        m_numPendingChunks = 0;
+    }
+
     noise::module::Perlin m_perlin;
 
+    bool m_sectionCulling = true;
+
+    // SoA tabeli za frustum culling: cele celice chunkov (za bfs) in tesni aabb-ji sekcij
+    // indeks celice je z * width + x, sekcije pa celica * numSections + sekcija
+    voxr::BoundsTable m_cellBounds;
+    voxr::BoundsTable m_sectionBounds;
+    const voxr::Chunk* m_tableChunks[voxr::ChunkManager::width * voxr::ChunkManager::width] = {};
+    std::vector<uint32_t> m_visibleBounds;
+
+    // posodobi samo celice, kjer je nov chunk ali so se mu spremenili bounds
+    void UpdateBoundsTables()
+    {
+        constexpr int width = voxr::ChunkManager::width;
+        constexpr int numSections = voxr::Chunk::numSections;
+
+        if (m_cellBounds.count == 0)
+        {
+            m_cellBounds.Resize(width * width);
+            m_sectionBounds.Resize(width * width * numSections);
+        }
+
+        for (int i = 0; i < width * width; i++)
+        {
+            voxr::Chunk* chunk = voxr::ChunkManager::GetChunk(i % width, i / width);
+            if (m_tableChunks[i] == chunk && !chunk->HaveBoundsChanged())
+                continue;
+
+            m_tableChunks[i] = chunk;
+            chunk->ClearBoundsChanged();
+
+            const glm::vec3& pos = chunk->GetPosition();
+            m_cellBounds.Set(i, pos - voxr::Chunk::worldWidth / 2.0f, pos + voxr::Chunk::worldWidth / 2.0f);
+
+            for (int section = 0; section < numSections; section++)
+            {
+                glm::vec3 min, max;
+                if (chunk->GetSectionBounds(section, &min, &max))
+                    m_sectionBounds.Set(i * numSections + section, min, max);
+                else
+                    m_sectionBounds.SetEmpty(i * numSections + section);
+            }
+        }
+    }
+
+    // oddaljenost od kamere do roba chunka (vodoravno), od katere naprej se uporabi lod 1, 2
+    // megla je pri FarTerrain dalec za mrezo chunkov, zato lod samo v zunanjih obrocih (rob mreze je ~20 od kamere),
+    // kjer so celice le se nekaj pikslov in se teren nadaljuje v se bolj grobem visinskem polju
+    bool m_lodEnabled = true;
+    constexpr float m_lodDistances[voxr::Chunk::numLods - 1] = { 14.0f, 18.0f };
+
+    int SelectLod(const voxr::Chunk* chunk, const glm::vec3& camPos)
+    {
+        if (!m_lodEnabled)
+            return 0;
+
+        // celica chunka in ne tesen aabb, ker je ta odvisen od loda
+        glm::vec2 center = glm::vec2(chunk->GetPosition().x, chunk->GetPosition().z);
+        glm::vec2 min = center - voxr::Chunk::worldWidth / 2.0f;
+        glm::vec2 max = center + voxr::Chunk::worldWidth / 2.0f;
+
+        glm::vec2 closest = glm::clamp(glm::vec2(camPos.x, camPos.z), min, max);
+        float dist = glm::length(closest - glm::vec2(camPos.x, camPos.z));
+
+        int lod = 0;
+        while (lod < voxr::Chunk::numLods - 1 && dist >= m_lodDistances[lod])
+            lod++;
+
+        return lod;
+    }
+
+    // bfs od sekcije s kamero, ki gre v sosednjo sekcijo samo ce je ploskev, skozi katero smo prisli,
+    // po zraku povezana s ploskvijo proti sosedu. nikoli ne gre nazaj proti kameri, zato je
+    // vsaka sekcija obiskana enkrat. inView je rezultat frustum cullinga za vsak chunk
+    void FindVisibleSections(const glm::vec3& camPos, const bool inView[][voxr::ChunkManager::width],
+        uint8_t outSections[][voxr::ChunkManager::width])
+    {
+        constexpr int width = voxr::ChunkManager::width;
+        constexpr int numSections = voxr::Chunk::numSections;
+
+        // isti vrstni red kot ploskve sekcij: -x, +x, -y, +y, -z, +z
+        constexpr int stepX[6] = { -1, 1, 0, 0, 0, 0 };
+        constexpr int stepY[6] = { 0, 0, -1, 1, 0, 0 };
+        constexpr int stepZ[6] = { 0, 0, 0, 0, -1, 1 };
+
+        struct Node
+        {
+            int x, section, z;
+            int entryFace; // -1 za sekcijo kamere
+            uint8_t directions; // smeri, v katere smo ze sli
+        };
+
+        glm::ivec3 cam = voxr::ChunkManager::WorldToVoxelIndex(camPos);
+
+        // kamera je izven mreze, ne vemo od kod zaceti
+        if (cam.x < 0 || cam.z < 0 || cam.x >= width * voxr::Chunk::width || cam.z >= width * voxr::Chunk::width)
+        {
+            for (int z = 0; z < width; z++)
+                for (int x = 0; x < width; x++)
+                    outSections[z][x] = voxr::Chunk::allSections;
+            return;
+        }
+
+        memset(outSections, 0, sizeof(uint8_t) * width * width);
+
+        // ploskve, skozi katere smo ze vstopili v sekcijo: skozi drugo ploskev je lahko
+        // povezana z drugimi ploskvami, zato jo takrat pregledamo se enkrat
+        uint8_t enteredFaces[width][width][numSections] = {};
+
+        // nad ali pod mrezo zacnemo v najblizji sekciji
+        Node start;
+        start.x = cam.x / voxr::Chunk::width;
+        start.z = cam.z / voxr::Chunk::width;
+        start.section = glm::clamp(cam.y, 0, voxr::Chunk::width - 1) / voxr::Chunk::sectionHeight;
+        start.entryFace = -1;
+        start.directions = 0;
+
+        static std::vector<Node> queue;
+        queue.clear();
+        queue.push_back(start);
+        outSections[start.z][start.x] |= 1 << start.section;
+        enteredFaces[start.z][start.x][start.section] = 0x3f; // iz sekcije kamere gremo ze na vse strani
+
+        for (size_t i = 0; i < queue.size(); i++)
+        {
+            Node node = queue[i];
+            const voxr::Chunk* chunk = voxr::ChunkManager::GetChunk(node.x, node.z);
+
+            for (int face = 0; face < 6; face++)
+            {
+                int opposite = face ^ 1;
+
+                if (node.directions & (1 << opposite))
+                    continue;
+
+                if (node.entryFace >= 0 && !chunk->AreFacesConnected(node.section, node.entryFace, face))
+                    continue;
+
+                Node next;
+                next.x = node.x + stepX[face];
+                next.section = node.section + stepY[face];
+                next.z = node.z + stepZ[face];
+
+                if (next.x < 0 || next.x >= width || next.z < 0 || next.z >= width || next.section < 0 || next.section >= numSections)
+                    continue;
+
+                if (!inView[next.z][next.x] || (enteredFaces[next.z][next.x][next.section] & (1 << opposite)))
+                    continue;
+
+                next.entryFace = opposite;
+                next.directions = node.directions | (1 << face);
+
+                enteredFaces[next.z][next.x][next.section] |= 1 << opposite;
+                outSections[next.z][next.x] |= 1 << next.section;
+                queue.push_back(next);
+            }
+        }
+    }
+
+
+    constexpr float m_perlinScale = 5.0f;
+    constexpr int m_waterHeight = 15; // v voxlih
+
+    // visina terena od 0 do 1 (delez visine chunka), uporablja jo tudi FarTerrain
+    float SampleTerrainHeight(float fx, float fz)
+    {
+        float height = m_perlin.GetValue(fx, 0.0f, fz);
+        return (height + 2.0f) / 6.0f;
+    }
 
     void PerlinTerrain(voxr::Chunk* chunk, glm::vec2 offset)
     {
-        chunk->Clear();
+        TIME_FUNCTION("GenerateChunk");
 
-        constexpr float perlinScale = 5.0f;
+        chunk->Clear();
 
         for (int z = 0; z < chunk->width; z++)
         {
             for (int x = 0; x < chunk->width; x++)
             {
-                float fx = ((float)x * 1.0f / 16.0f + offset.x) / perlinScale;
-                float fz = ((float)z * 1.0f / 16.0f + offset.y) / perlinScale;
+                float fx = ((float)x * 1.0f / 16.0f + offset.x) / m_perlinScale;
+                float fz = ((float)z * 1.0f / 16.0f + offset.y) / m_perlinScale;
 
-                float height = m_perlin.GetValue(fx, 0.0f, fz);
-                height = (height + 2.0f) / 6.0f;
+                float height = SampleTerrainHeight(fx, fz);
 
                 int blocks = height * chunk->width;
 
@@ -50,8 +304,7 @@ namespace
                     chunk->SetVoxel(v, x, y, z);
                 }
 
-                constexpr int waterHeight = 15;
-                for (int y = blocks; y < waterHeight; y++)
+                for (int y = blocks; y < m_waterHeight; y++)
                 {
                     chunk->SetVoxel(voxr::Voxel::Water, x, y, z);
                 }
@@ -111,13 +364,15 @@ namespace voxr
                     Chunk* chunk = new Chunk;
                     SetChunk(chunk, x, z);
                     //PerlinTerrain(chunk, glm::vec2(Chunk::worldWidth * x, Chunk::worldWidth * z));
-                    m_loadQueue.push_back({ chunk, glm::vec2(Chunk::worldWidth * x, Chunk::worldWidth * z) });
+                    QueueChunk(chunk, glm::vec2(Chunk::worldWidth * x, Chunk::worldWidth * z));
                 }
             }
         }
 
         void DeleteChunks()
         {
+            CancelLoadChunks();
+
             for (int z = 0; z < width; z++)
                 for (int x = 0; x < width; x++)
                     delete m_chunks[z][x];
@@ -128,12 +383,15 @@ namespace voxr
             Chunk* chunk = GetChunk(x, z);
 
             // ce ne izbrisem se iz load queue-ja potem bo crash ko bo prisel na vrsto za loadanje
-            for (auto it = m_loadQueue.begin(); it != m_loadQueue.end(); it++)
+            if (chunk->IsQueued())
             {
-                if (it->chunk == chunk)
+                for (auto it = m_loadQueue.begin(); it != m_loadQueue.end(); it++)
                 {
-                    m_loadQueue.erase(it);
-                    break;
+                    if (it->chunk == chunk)
+                    {
+                        m_loadQueue.erase(it);
+                        break;
+                    }
                 }
             }
 
@@ -165,7 +423,7 @@ namespace voxr
                 pos.x = m_centerChunkPos.x + Chunk::worldWidth * (width - 1);
                 pos.y = m_centerChunkPos.z + Chunk::worldWidth * (z);
 
-                m_loadQueue.push_back({ chunk, pos });
+                QueueChunk(chunk, pos);
                 //PerlinTerrain(chunk, pos);
             }
         }
@@ -195,7 +453,7 @@ namespace voxr
                 pos.x = m_centerChunkPos.x;
                 pos.y = m_centerChunkPos.z + Chunk::worldWidth * (z);
 
-                m_loadQueue.push_back({ chunk, pos });
+                QueueChunk(chunk, pos);
                 //PerlinTerrain(chunk, pos);
             }
         }
@@ -225,7 +483,7 @@ namespace voxr
                 pos.x = m_centerChunkPos.x + Chunk::worldWidth * x;
                 pos.y = m_centerChunkPos.z + Chunk::worldWidth * (width - 1);
 
-                m_loadQueue.push_back({ chunk, pos });
+                QueueChunk(chunk, pos);
                 //PerlinTerrain(chunk, pos);
             }
         }
@@ -255,16 +513,23 @@ namespace voxr
                 pos.x = m_centerChunkPos.x + Chunk::worldWidth * x;
                 pos.y = m_centerChunkPos.z;
 
-                m_loadQueue.push_back({ chunk, pos });
+                QueueChunk(chunk, pos);
                 //PerlinTerrain(chunk, pos);
             }
         }
 
         void UpdateCameraPos(const glm::vec3& camPos)
         {
+            TIME_FUNCTION("UpdateCameraPos");
+
             constexpr float chunkUpdateWidth = Chunk::worldWidth / 1.7f;
 
-            if (camPos.x > m_centerChunkPos.x + chunkUpdateWidth)
+            if (m_numPendingChunks > 0)
+            {
+                // med nalaganjem ne premikamo chunkov, ker so indeksi ze dodeljeni
+                UploadLoadedChunks(m_uploadsPerFrame);
+            }
+            else if (camPos.x > m_centerChunkPos.x + chunkUpdateWidth)
             {
                 UpdateCameraRight();
             }
@@ -284,41 +549,202 @@ namespace voxr
             //while (m_loadQueue.empty() == false)
             if (m_loadQueue.empty() == false)
             {
-                const LoadItem& loadItem = m_loadQueue.front();
+                LoadItem loadItem = PopQueuedChunk();
+                PerlinTerrain(loadItem.chunk, loadItem.pos);
+            }
+        }
+
+        void RenderChunks()
+        {
+            TIME_FUNCTION("RenderChunks");
+
+            static std::vector<const Chunk*> visible;
+            visible.clear();
+
+            // lod najprej, ker od njega so odvisni bounds v tabelah
+            for (int z = 0; z < width; z++)
+                for (int x = 0; x < width; x++)
+                    GetChunk(x, z)->SetLod(SelectLod(GetChunk(x, z), voxr::GetCameraPos()));
+
+            UpdateBoundsTables();
 
+            // za bfs celotna kocka chunka, ker se skozi prazne chunke tudi vidi
+            bool inView[width][width] = {};
+            voxr::CullBounds(m_cellBounds, m_visibleBounds);
+            for (uint32_t i : m_visibleBounds)
+                inView[i / width][i % width] = true;
+
+            // sekcije, do katerih se od kamere ne pride po zraku (jame, za hribi), se ne risejo
+            uint8_t sections[width][width];
+            if (m_sectionCulling)
+                FindVisibleSections(voxr::GetCameraPos(), inView, sections);
+
+            // tesni aabb-ji sekcij, prazne sekcije odpadejo
+            uint8_t sectionsInView[width * width] = {};
+            voxr::CullBounds(m_sectionBounds, m_visibleBounds);
+            for (uint32_t i : m_visibleBounds)
+                sectionsInView[i / Chunk::numSections] |= 1 << (i % Chunk::numSections);
+
+            for (int i = 0; i < width * width; i++)
+            {
+                uint8_t mask = sectionsInView[i];
+                if (m_sectionCulling)
+                    mask &= sections[i / width][i % width];
+
+                if (mask == 0)
+                    continue;
+
+                Chunk* chunk = GetChunk(i % width, i / width);
+                chunk->SetVisibleSections(mask);
+                visible.push_back(chunk);
+            }
+
+            // od blizu proti dalec, da early depth test zavrze cim vec fragmentov
+            const glm::vec3& camPos = voxr::GetCameraPos();
+            std::sort(visible.begin(), visible.end(), [&camPos](const Chunk* a, const Chunk* b)
+            {
+                glm::vec3 da = a->GetPosition() - camPos;
+                glm::vec3 db = b->GetPosition() - camPos;
+                return glm::dot(da, da) < glm::dot(db, db);
+            });
+
+            // najblizji chunki zakrijejo tiste za njimi (npr. za hribom)
+            if (voxr::Occlusion::IsEnabled())
+            {
+                voxr::Occlusion::RenderOccluders(voxr::GetViewProj(), visible);
+
+                visible.erase(std::remove_if(visible.begin(), visible.end(), [](const Chunk* chunk)
+                {
+                    glm::vec3 min, max;
+                    chunk->GetBounds(&min, &max);
+                    return !voxr::Occlusion::IsVisible(min, max);
+                }), visible.end());
+            }
+
+            voxr::DrawChunks(visible);
+        }
+
+        void SetSectionCulling(bool enabled)
+        {
+            m_sectionCulling = enabled;
+        }
+
+        bool GetSectionCulling()
+        {
+            return m_sectionCulling;
+        }
+
+        void SetLodEnabled(bool enabled)
+        {
+            m_lodEnabled = enabled;
+        }
+
+        bool GetLodEnabled()
+        {
+            return m_lodEnabled;
+        }
+
+        void FlushLoadQueue()
+        {
+            while (m_loadQueue.empty() == false)
+            {
+                LoadItem loadItem = PopQueuedChunk();
                 PerlinTerrain(loadItem.chunk, loadItem.pos);
+            }
 
-                m_loadQueue.pop_front();
+            if (m_loadThread.joinable())
+            {
+                m_loadThread.join();
+                UploadLoadedChunks(width * width);
             }
         }
 
-        void RenderChunks()
+        void RemeshDirtyChunks()
         {
+            TIME_FUNCTION("RemeshDirtyChunks");
+
+            std::vector<Chunk*> dirty;
+
             for (int z = 0; z < width; z++)
             {
                 for (int x = 0; x < width; x++)
                 {
                     Chunk* chunk = GetChunk(x, z);
-                    glm::vec3 pos = glm::vec3(Chunk::worldWidth * x, 0.0f, Chunk::worldWidth * z);
-                    pos.x -= ChunkManager::width / 2 * Chunk::worldWidth;
-                    pos.z -= ChunkManager::width / 2 * Chunk::worldWidth;
-                    pos += glm::vec3(1.0f / 16.0f / 2.0f);
-                    pos += m_centerChunkPos;
-
-                    if (voxr::IsChunkInView(chunk, pos))
-                        voxr::DrawChunk(*chunk, pos);
+
+                    // queued bo itak se generiran
+                    if (chunk->IsMeshDirty() && !chunk->IsQueued())
+                        dirty.push_back(chunk);
                 }
             }
+
+            // meshi se gradijo vzporedno, upload pa mora biti na main niti
+#pragma omp parallel for schedule(dynamic, 1)
+            for (int i = 0; i < (int)dirty.size(); i++)
+                dirty[i]->BuildMesh();
+
+            for (Chunk* chunk : dirty)
+                chunk->UploadMesh();
         }
 
-        void FlushLoadQueue()
+        void LoadChunksAsync(const std::function<void(Chunk* chunk, int x, int z)>& decode)
         {
-            while (m_loadQueue.empty() == false)
+            m_loadQueue.clear();
+            DeleteChunks();
+
+            constexpr int c = width / 2;
+            std::vector<glm::ivec2> order;
+
+            for (int z = 0; z < width; z++)
             {
-                const LoadItem& loadItem = m_loadQueue.front();
-                PerlinTerrain(loadItem.chunk, loadItem.pos);
-                m_loadQueue.pop_front();
+                for (int x = 0; x < width; x++)
+                {
+                    Chunk* chunk = new Chunk;
+                    SetChunk(chunk, x, z);
+
+                    if (x == c && z == c)
+                    {
+                        // sredinskega rabimo takoj, da ne pademo skozi
+                        decode(chunk, x, z);
+                        chunk->RebuildHeightmap();
+                        chunk->GenerateMesh();
+                    }
+                    else
+                    {
+                        chunk->Clear();
+                        order.push_back(glm::ivec2(x, z));
+                    }
+                }
             }
+
+            std::sort(order.begin(), order.end(), [](glm::ivec2 a, glm::ivec2 b) {
+                return DistFromCenter(a) < DistFromCenter(b);
+            });
+
+            m_numPendingChunks = (int)order.size();
+
+            m_loadThread = std::thread([decode, order]() {
+                Profiler::SetThreadName("chunk loader");
+
+#pragma omp parallel for schedule(dynamic, 1)
+                for (int i = 0; i < (int)order.size(); i++)
+                {
+                    if (m_cancelLoad)
+                        continue;
+
+                    Chunk* chunk = new Chunk;
+                    decode(chunk, order[i].x, order[i].y);
+                    chunk->RebuildHeightmap();
+                    chunk->BuildMesh();
+
+                    std::lock_guard<std::mutex> lock(m_loadedMutex);
+                    m_loadedChunks.push_back({ chunk, order[i] });
+                }
+            });
+        }
+
+        bool IsLoadingChunks()
+        {
+            return m_numPendingChunks > 0;
         }
 
         int GetSeed()
@@ -345,6 +771,33 @@ namespace voxr
             assert(z >= 0 && z < width && "chunk index out of bounds!");
 
             m_chunks[z][x] = chunk;
+            chunk->SetPosition(GetChunkPos(x, z));
+        }
+
+        glm::vec3 GetChunkPos(int x, int z)
+        {
+            glm::vec3 pos = glm::vec3(Chunk::worldWidth * x, 0.0f, Chunk::worldWidth * z);
+            pos.x -= width / 2 * Chunk::worldWidth;
+            pos.z -= width / 2 * Chunk::worldWidth;
+            pos += glm::vec3(1.0f / 16.0f / 2.0f);
+            pos += m_centerChunkPos;
+            return pos;
+        }
+
+        glm::ivec2 GetChunkCoord(int x, int z)
+        {
+            glm::ivec2 center = glm::ivec2(glm::round(glm::vec2(m_centerChunkPos.x, m_centerChunkPos.z) / Chunk::worldWidth));
+            return center + glm::ivec2(x, z);
+        }
+
+        bool FindChunkIndex(const glm::ivec2& chunkCoord, glm::ivec2* outIndex)
+        {
+            glm::ivec2 index = chunkCoord - GetChunkCoord(0, 0);
+            if (index.x < 0 || index.x >= width || index.y < 0 || index.y >= width)
+                return false;
+
+            *outIndex = index;
+            return true;
         }
 
         const glm::vec3& GetCenterChunkPos()
@@ -356,6 +809,90 @@ namespace voxr
         {
             m_centerChunkPos = pos;
         }
+
+        glm::vec3 GetVoxelGridOrigin()
+        {
+            constexpr float offset = width / 2 * Chunk::worldWidth + Chunk::worldWidth / 2.0f;
+            return m_centerChunkPos - glm::vec3(offset, Chunk::worldWidth / 2.0f, offset);
+        }
+
+        glm::ivec3 WorldToVoxelIndex(const glm::vec3& pos)
+        {
+            return glm::ivec3(glm::floor((pos - GetVoxelGridOrigin()) * 16.0f));
+        }
+
+        bool IsVoxelIndexValid(const glm::ivec3& index)
+        {
+            return index.x >= 0 && index.x < width * Chunk::width &&
+                index.y >= 0 && index.y < Chunk::width &&
+                index.z >= 0 && index.z < width * Chunk::width;
+        }
+
+        Voxel GetVoxel(const glm::ivec3& index)
+        {
+            if (!IsVoxelIndexValid(index))
+                return Voxel::Air;
+
+            Chunk* chunk = GetChunk(index.x / Chunk::width, index.z / Chunk::width);
+            return chunk->GetVoxel(index.x % Chunk::width, index.y, index.z % Chunk::width);
+        }
+
+        void SetVoxel(const glm::ivec3& index, Voxel v)
+        {
+            if (!IsVoxelIndexValid(index))
+                return;
+
+            Chunk* chunk = GetChunk(index.x / Chunk::width, index.z / Chunk::width);
+            chunk->SetVoxel(v, index.x % Chunk::width, index.y, index.z % Chunk::width);
+            MarkNeighborsDirty(index);
+        }
+
+        // mesher zdaj ne bere sosedov: robne ploskve vedno doda, ker so skirti proti sosedom z drugim lod-om
+        // in ker loader nit gradi meshe, ko sosedi se niso nalozeni. oznaka sosedov mesha torej ne spremeni,
+        // je pa pogoj, da lahko BuildMesh kasneje reze robne ploskve s sosedi brez zastarelih meshov.
+        // cena je majhna: samo voxli v robnih stolpcih, RemeshDirtyChunks pa vec oznak istega chunka v
+        // enem frameu zdruzi v en remesh na workerjih
+        void MarkNeighborsDirty(const glm::ivec3& index)
+        {
+            glm::ivec2 chunkIndex = glm::ivec2(index.x / Chunk::width, index.z / Chunk::width);
+            glm::ivec2 local = glm::ivec2(index.x % Chunk::width, index.z % Chunk::width);
+
+            if (local.x == 0 && chunkIndex.x > 0)
+                GetChunk(chunkIndex.x - 1, chunkIndex.y)->MarkMeshDirty();
+            if (local.x == Chunk::width - 1 && chunkIndex.x < width - 1)
+                GetChunk(chunkIndex.x + 1, chunkIndex.y)->MarkMeshDirty();
+            if (local.y == 0 && chunkIndex.y > 0)
+                GetChunk(chunkIndex.x, chunkIndex.y - 1)->MarkMeshDirty();
+            if (local.y == Chunk::width - 1 && chunkIndex.y < width - 1)
+                GetChunk(chunkIndex.x, chunkIndex.y + 1)->MarkMeshDirty();
+        }
+
+        float GetSurfaceHeight(float worldX, float worldZ)
+        {
+            glm::vec3 origin = GetVoxelGridOrigin();
+            glm::ivec3 index = WorldToVoxelIndex(glm::vec3(worldX, origin.y, worldZ));
+
+            if (!IsVoxelIndexValid(index))
+                return origin.y;
+
+            Chunk* chunk = GetChunk(index.x / Chunk::width, index.z / Chunk::width);
+            return origin.y + chunk->GetColumnHeight(index.x % Chunk::width, index.z % Chunk::width) / 16.0f;
+        }
+
+        float GetTerrainHeight(float worldX, float worldZ)
+        {
+            // PerlinTerrain dobi zamik m_centerChunkPos + indeks chunka * worldWidth za voxel 0 chunka
+            glm::vec3 origin = GetVoxelGridOrigin();
+            float fx = (worldX - origin.x + m_centerChunkPos.x) / m_perlinScale;
+            float fz = (worldZ - origin.z + m_centerChunkPos.z) / m_perlinScale;
+
+            return origin.y + SampleTerrainHeight(fx, fz) * Chunk::worldWidth;
+        }
+
+        float GetWaterHeight()
+        {
+            return GetVoxelGridOrigin().y + m_waterHeight / 16.0f;
+        }
     }
 
 }
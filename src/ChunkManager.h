@@ -2,6 +2,8 @@
 
 #include "Chunk.h"
 #include <glm/vec3.hpp>
+#include <glm/vec2.hpp>
+#include <functional>
 
 namespace voxr
 {
@@ -14,17 +16,56 @@ namespace voxr
         void UpdateCameraPos(const glm::vec3& camPos);
         void RenderChunks();
 
+        // risejo se samo sekcije, ki so od kamere vidne skozi zrak (tipka V)
+        void SetSectionCulling(bool enabled);
+        bool GetSectionCulling();
+
+        // oddaljeni chunki se risejo z manjsimi lod meshi (tipka L)
+        void SetLodEnabled(bool enabled);
+        bool GetLodEnabled();
+
         void FlushLoadQueue();
 
+        // zgradi meshe vseh chunkov, ki so bili spremenjeni od zadnjega klica, vsakega enkrat
+        void RemeshDirtyChunks();
+
+        // zbrise vse chunke in jih nalozi na delovnih nitih, najblizji najprej
+        // decode se klice vzporedno in mora napolniti voxle chunka na indeksu x, z
+        // sredinski chunk se nalozi takoj, ostali se uploadajo v naslednjih frameih
+        void LoadChunksAsync(const std::function<void(Chunk* chunk, int x, int z)>& decode);
+        bool IsLoadingChunks();
+
         int GetSeed();
         void SetSeed(int seed);
 
         Chunk* GetChunk(int x, int z);
         void SetChunk(Chunk* chunk, int x, int z);
+        glm::vec3 GetChunkPos(int x, int z); // center chunka v svetu
+
+        // absolutna koordinata chunka, ki se ne spremeni ko se chunki premaknejo
+        glm::ivec2 GetChunkCoord(int x, int z);
+        bool FindChunkIndex(const glm::ivec2& chunkCoord, glm::ivec2* outIndex);
 
         const glm::vec3& GetCenterChunkPos();
         void SetCenterChunkPos(const glm::vec3& pos);
 
+        // globalni indeksi voxlov cez vse chunke:
+        // x in z od 0 do width * Chunk::width, y od 0 do Chunk::width
+        glm::vec3 GetVoxelGridOrigin(); // spodnji kot voxla 0, 0, 0
+        glm::ivec3 WorldToVoxelIndex(const glm::vec3& pos);
+        bool IsVoxelIndexValid(const glm::ivec3& index);
+        Voxel GetVoxel(const glm::ivec3& index); // zunaj mreze vrne Air
+        void SetVoxel(const glm::ivec3& index, Voxel v); // zunaj mreze ne naredi nic
+        // oznaci sosednje chunke, ce je voxel na robu svojega chunka (zakaj kljub robnim ploskvam, glej ChunkManager.cpp)
+        void MarkNeighborsDirty(const glm::ivec3& index);
+
+        // y vrha najvisjega polnega voxla v stolpcu (dno mreze ce je stolpec prazen ali zunaj)
+        float GetSurfaceHeight(float worldX, float worldZ);
+
+        // visina generiranega terena direktno iz suma, tudi izven mreze (brez vode, dreves in urejanja)
+        float GetTerrainHeight(float worldX, float worldZ);
+        float GetWaterHeight();
+
         inline constexpr int width = 11;
     }
 
@@ -0,0 +1,157 @@
+#include "Collision.h"
+#include "ChunkManager.h"
+#include <glm/glm.hpp>
+
+namespace voxr::Collision
+{
+    namespace
+    {
+        constexpr float m_playerHalfWidth = 0.04f;
+        constexpr float m_eyeHeight = 0.14f; // od nog do kamere
+        constexpr float m_headHeight = 0.02f; // od kamere do vrha glave
+        constexpr float m_stepHeight = 1.0f / 16.0f;
+
+        constexpr float m_eps = 0.001f; // v enotah voxlov
+
+        // ali je kateri od voxlov v plasti layer na osi axis, znotraj preseka aabb-ja, poln
+        // min in max sta v enotah voxlov
+        bool IsLayerSolid(int axis, int layer, const glm::vec3& min, const glm::vec3& max)
+        {
+            int a = (axis + 1) % 3;
+            int b = (axis + 2) % 3;
+
+            int aStart = (int)glm::floor(min[a] + m_eps);
+            int aEnd = (int)glm::ceil(max[a] - m_eps);
+            int bStart = (int)glm::floor(min[b] + m_eps);
+            int bEnd = (int)glm::ceil(max[b] - m_eps);
+
+            glm::vec3 origin = ChunkManager::GetVoxelGridOrigin();
+            glm::ivec3 index;
+            index[axis] = layer;
+
+            for (index[a] = aStart; index[a] < aEnd; index[a]++)
+            {
+                for (index[b] = bStart; index[b] < bEnd; index[b]++)
+                {
+                    // nad najvisjim voxlom stolpca je samo zrak (pri padanju in hoji po terenu skoraj vedno)
+                    float surface = ChunkManager::GetSurfaceHeight(origin.x + (index.x + 0.5f) / 16.0f, origin.z + (index.z + 0.5f) / 16.0f);
+                    if (index.y >= (int)glm::round((surface - origin.y) * 16.0f))
+                        continue;
+
+                    if (ChunkManager::GetVoxel(index) != Voxel::Air)
+                        return true;
+                }
+            }
+
+            return false;
+        }
+
+        // premakne box po eni osi do prvega polnega voxla, vrne dejanski premik
+        float SweepAxis(Physics::AABB& box, int axis, float delta)
+        {
+            if (delta == 0.0f)
+                return 0.0f;
+
+            glm::vec3 origin = ChunkManager::GetVoxelGridOrigin();
+            glm::vec3 min = (box.min - origin) * 16.0f;
+            glm::vec3 max = (box.max - origin) * 16.0f;
+            float d = delta * 16.0f;
+
+            if (d > 0.0f)
+            {
+                int first = (int)glm::ceil(max[axis] - m_eps);
+                int last = (int)glm::ceil(max[axis] + d) - 1;
+
+                for (int layer = first; layer <= last; layer++)
+                {
+                    if (IsLayerSolid(axis, layer, min, max))
+                    {
+                        d = glm::max(layer - max[axis], 0.0f);
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                int first = (int)glm::floor(min[axis] + m_eps) - 1;
+                int last = (int)glm::floor(min[axis] + d);
+
+                for (int layer = first; layer >= last; layer--)
+                {
+                    if (IsLayerSolid(axis, layer, min, max))
+                    {
+                        d = glm::min(layer + 1 - min[axis], 0.0f);
+                        break;
+                    }
+                }
+            }
+
+            float moved = d / 16.0f;
+            box.min[axis] += moved;
+            box.max[axis] += moved;
+            return moved;
+        }
+    }
+
+    Physics::AABB GetPlayerAABB(const glm::vec3& camPos)
+    {
+        Physics::AABB box;
+        box.min = camPos - glm::vec3(m_playerHalfWidth, m_eyeHeight, m_playerHalfWidth);
+        box.max = camPos + glm::vec3(m_playerHalfWidth, m_headHeight, m_playerHalfWidth);
+        return box;
+    }
+
+    bool IsPlayerOnGround(const glm::vec3& camPos)
+    {
+        Physics::AABB box = GetPlayerAABB(camPos);
+
+        glm::vec3 origin = ChunkManager::GetVoxelGridOrigin();
+        glm::vec3 min = (box.min - origin) * 16.0f;
+        glm::vec3 max = (box.max - origin) * 16.0f;
+
+        // plast tik pod nogami
+        return IsLayerSolid(1, (int)glm::floor(min.y + m_eps) - 1, min, max);
+    }
+
+    glm::vec3 MovePlayer(const glm::vec3& camPos, const glm::vec3& delta, glm::bvec3* outBlocked)
+    {
+        Physics::AABB box = GetPlayerAABB(camPos);
+        glm::bvec3 blocked = glm::bvec3(false);
+
+        glm::vec2 horizontal;
+        horizontal.x = SweepAxis(box, 0, delta.x);
+        horizontal.y = SweepAxis(box, 2, delta.z);
+        blocked.x = horizontal.x != delta.x;
+        blocked.z = horizontal.y != delta.z;
+
+        if ((blocked.x || blocked.z) && IsPlayerOnGround(camPos))
+        {
+            // poskusimo se enkrat en voxel visje
+            Physics::AABB stepBox = GetPlayerAABB(camPos);
+
+            if (SweepAxis(stepBox, 1, m_stepHeight) == m_stepHeight)
+            {
+                glm::vec2 stepHorizontal;
+                stepHorizontal.x = SweepAxis(stepBox, 0, delta.x);
+                stepHorizontal.y = SweepAxis(stepBox, 2, delta.z);
+
+                if (glm::abs(stepHorizontal.x) + glm::abs(stepHorizontal.y) > glm::abs(horizontal.x) + glm::abs(horizontal.y))
+                {
+                    // pristanemo na stopnici
+                    SweepAxis(stepBox, 1, -m_stepHeight);
+
+                    box = stepBox;
+                    blocked.x = stepHorizontal.x != delta.x;
+                    blocked.z = stepHorizontal.y != delta.z;
+                }
+            }
+        }
+
+        blocked.y = SweepAxis(box, 1, delta.y) != delta.y;
+
+        if (outBlocked)
+            *outBlocked = blocked;
+
+        return box.min + glm::vec3(m_playerHalfWidth, m_eyeHeight, m_playerHalfWidth);
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Physics.h"
+#include <glm/vec3.hpp>
+
+namespace voxr::Collision
+{
+    // aabb igralca okoli kamere (kamera je v visini oci)
+    Physics::AABB GetPlayerAABB(const glm::vec3& camPos);
+
+    bool IsPlayerOnGround(const glm::vec3& camPos);
+
+    // premakne kamero za delta, trke z voxli razresuje po vsaki osi posebej
+    // ce igralec stoji na tleh lahko stopi na en voxel visoko stopnico
+    // outBlocked pove na katerih oseh se je premik ustavil
+    glm::vec3 MovePlayer(const glm::vec3& camPos, const glm::vec3& delta, glm::bvec3* outBlocked = nullptr);
+}
@@ -1,16 +1,43 @@
 #include "Editing.h"
 #include "VoxelRenderer.h"
 #include "ChunkManager.h"
+#include "Journal.h"
+#include "FuncTimer.h"
 
 namespace voxr
 {
     namespace
     {
         float m_ignoreClickTime = 0.0f;
+        Brush m_brush;
+
+        bool IsInBrush(const Brush& brush, const glm::ivec3& d)
+        {
+            int r = brush.radius;
+
+            switch (brush.shape)
+            {
+            case BrushShape::Sphere:
+                return d.x * d.x + d.y * d.y + d.z * d.z <= r * r;
+            case BrushShape::Box:
+                return glm::abs(d.x) <= r && glm::abs(d.y) <= r && glm::abs(d.z) <= r;
+            case BrushShape::Cylinder:
+                return d.x * d.x + d.z * d.z <= r * r && glm::abs(d.y) <= r;
+            }
+
+            return false;
+        }
+
+        glm::ivec3 GetGlobalVoxelIndex(const voxr::Physics::HitResult& hit)
+        {
+            return glm::ivec3(hit.chunkIndex.x * Chunk::width, 0, hit.chunkIndex.y * Chunk::width) + hit.voxelIndex;
+        }
     }
 
-void HandleVoxelEditing(voxr::Physics::HitResult& hit, float deltaTime)
+void HandleVoxelEditing(const voxr::Physics::HitResult* hit, float deltaTime)
 {
+    TIME_FUNCTION("HandleVoxelEditing");
+
     static float timeHoldingRight = 0.0f;
     static float timeHoldingLeft = 0.0f;
 
@@ -22,93 +49,52 @@ void HandleVoxelEditing(voxr::Physics::HitResult& hit, float deltaTime)
         return;
     }
 
-    if (glfwGetMouseButton(voxr::GetWindow(), GLFW_MOUSE_BUTTON_RIGHT))
+    bool rightDown = glfwGetMouseButton(voxr::GetWindow(), GLFW_MOUSE_BUTTON_RIGHT);
+    bool leftDown = glfwGetMouseButton(voxr::GetWindow(), GLFW_MOUSE_BUTTON_LEFT);
+
+    // spust gumba in konec transakcije obdelamo vsak frame, tudi ce ne gledamo v teren
+    // brez zadetka se pritisnjen gumb ne uposteva, potez se nadaljuje, ko spet zadanemo
+    if (hit && rightDown)
     {
+        // celoten potez z drzanjem gumba je ena transakcija za undo
+        if (timeHoldingRight == 0.0f)
+            Journal::BeginTransaction();
+
         if (timeHoldingRight == 0.0f || timeHoldingRight > 0.5f)
         {
-            hit.chunk->SetVoxel(voxr::Voxel::Air, hit.voxelIndex.x, hit.voxelIndex.y, hit.voxelIndex.z);
-
-            if (hit.voxelIndex.x != 0)
-                hit.chunk->SetVoxel(voxr::Voxel::Air, hit.voxelIndex.x - 1, hit.voxelIndex.y, hit.voxelIndex.z);
-            else
-                voxr::ChunkManager::GetChunk(hit.chunkIndex.x - 1, hit.chunkIndex.y)->SetVoxel(voxr::Voxel::Air, voxr::Chunk::width - 1, hit.voxelIndex.y, hit.voxelIndex.z);
-
-            if (hit.voxelIndex.y != 0)
-                hit.chunk->SetVoxel(voxr::Voxel::Air, hit.voxelIndex.x, hit.voxelIndex.y - 1, hit.voxelIndex.z);
-
-            if (hit.voxelIndex.z != 0)
-                hit.chunk->SetVoxel(voxr::Voxel::Air, hit.voxelIndex.x, hit.voxelIndex.y, hit.voxelIndex.z - 1);
-            else
-                voxr::ChunkManager::GetChunk(hit.chunkIndex.x, hit.chunkIndex.y - 1)->SetVoxel(voxr::Voxel::Air, hit.voxelIndex.x, hit.voxelIndex.y, voxr::Chunk::width - 1);
-
-            //
-
-            if (hit.voxelIndex.x != voxr::Chunk::width - 1)
-                hit.chunk->SetVoxel(voxr::Voxel::Air, hit.voxelIndex.x + 1, hit.voxelIndex.y, hit.voxelIndex.z);
-            else
-                voxr::ChunkManager::GetChunk(hit.chunkIndex.x + 1, hit.chunkIndex.y)->SetVoxel(voxr::Voxel::Air, 0, hit.voxelIndex.y, hit.voxelIndex.z);
-
-            if (hit.voxelIndex.y != voxr::Chunk::width - 1)
-                hit.chunk->SetVoxel(voxr::Voxel::Air, hit.voxelIndex.x, hit.voxelIndex.y + 1, hit.voxelIndex.z);
-
-            if (hit.voxelIndex.z != voxr::Chunk::width - 1)
-                hit.chunk->SetVoxel(voxr::Voxel::Air, hit.voxelIndex.x, hit.voxelIndex.y, hit.voxelIndex.z + 1);
-            else
-                voxr::ChunkManager::GetChunk(hit.chunkIndex.x, hit.chunkIndex.y + 1)->SetVoxel(voxr::Voxel::Air, hit.voxelIndex.x, hit.voxelIndex.y, 0);
-
-
-            hit.chunk->GenerateMesh();
+            ApplyBrush(m_brush, GetGlobalVoxelIndex(*hit), voxr::Voxel::Air);
             timeHoldingRight -= 1.0f / editsPerSecond;
         }
 
         timeHoldingRight += deltaTime;
     }
-    else
+    else if (!rightDown)
     {
+        if (timeHoldingRight != 0.0f)
+            Journal::EndTransaction();
+
         timeHoldingRight = 0.0f;
     }
 
-    if (glfwGetMouseButton(voxr::GetWindow(), GLFW_MOUSE_BUTTON_LEFT))
+    if (hit && leftDown)
     {
+        if (timeHoldingLeft == 0.0f)
+            Journal::BeginTransaction();
+
         if (timeHoldingLeft == 0.0f || timeHoldingLeft > 0.5f)
         {
-            if (hit.voxelIndex.x != 0)
-                hit.chunk->SetVoxel(hit.voxel, hit.voxelIndex.x - 1, hit.voxelIndex.y, hit.voxelIndex.z);
-            else
-                voxr::ChunkManager::GetChunk(hit.chunkIndex.x - 1, hit.chunkIndex.y)->SetVoxel(hit.voxel, voxr::Chunk::width - 1, hit.voxelIndex.y, hit.voxelIndex.z);
-
-            if (hit.voxelIndex.y != 0)
-                hit.chunk->SetVoxel(hit.voxel, hit.voxelIndex.x, hit.voxelIndex.y - 1, hit.voxelIndex.z);
-
-            if (hit.voxelIndex.z != 0)
-                hit.chunk->SetVoxel(hit.voxel, hit.voxelIndex.x, hit.voxelIndex.y, hit.voxelIndex.z - 1);
-            else
-                voxr::ChunkManager::GetChunk(hit.chunkIndex.x, hit.chunkIndex.y - 1)->SetVoxel(hit.voxel, hit.voxelIndex.x, hit.voxelIndex.y, voxr::Chunk::width - 1);
-
-            //
-
-            if (hit.voxelIndex.x != voxr::Chunk::width - 1)
-                hit.chunk->SetVoxel(hit.voxel, hit.voxelIndex.x + 1, hit.voxelIndex.y, hit.voxelIndex.z);
-            else
-                voxr::ChunkManager::GetChunk(hit.chunkIndex.x + 1, hit.chunkIndex.y)->SetVoxel(hit.voxel, 0, hit.voxelIndex.y, hit.voxelIndex.z);
-
-            if (hit.voxelIndex.y != voxr::Chunk::width - 1)
-                hit.chunk->SetVoxel(hit.voxel, hit.voxelIndex.x, hit.voxelIndex.y + 1, hit.voxelIndex.z);
-
-            if (hit.voxelIndex.z != voxr::Chunk::width - 1)
-                hit.chunk->SetVoxel(hit.voxel, hit.voxelIndex.x, hit.voxelIndex.y, hit.voxelIndex.z + 1);
-            else
-                voxr::ChunkManager::GetChunk(hit.chunkIndex.x, hit.chunkIndex.y + 1)->SetVoxel(hit.voxel, hit.voxelIndex.x, hit.voxelIndex.y, 0);
-
-
-            hit.chunk->GenerateMesh();
+            // postavimo pred stran, ki jo gledamo
+            ApplyBrush(m_brush, GetGlobalVoxelIndex(*hit) + hit->normal, hit->voxel);
             timeHoldingLeft -= 1.0f / editsPerSecond;
         }
 
         timeHoldingLeft += deltaTime;
     }
-    else
+    else if (!leftDown)
     {
+        if (timeHoldingLeft != 0.0f)
+            Journal::EndTransaction();
+
         timeHoldingLeft = 0.0f;
     }
 }
@@ -118,4 +104,69 @@ void SetIgnoreClickTime(float time)
     m_ignoreClickTime = time;
 }
 
+void ApplyBrush(const Brush& brush, const glm::ivec3& center, Voxel voxel)
+{
+    constexpr int gridWidth = ChunkManager::width * Chunk::width;
+
+    glm::ivec3 min = glm::max(center - brush.radius, glm::ivec3(0));
+    glm::ivec3 max = glm::min(center + brush.radius, glm::ivec3(gridWidth - 1, Chunk::width - 1, gridWidth - 1));
+
+    if (glm::any(glm::greaterThan(min, max)))
+        return;
+
+    bool ownTransaction = !Journal::IsInTransaction();
+    if (ownTransaction)
+        Journal::BeginTransaction();
+
+    // gremo chunk po chunk, da vsakega poiscemo samo enkrat
+    for (int cz = min.z / Chunk::width; cz <= max.z / Chunk::width; cz++)
+    {
+        for (int cx = min.x / Chunk::width; cx <= max.x / Chunk::width; cx++)
+        {
+            Chunk* chunk = ChunkManager::GetChunk(cx, cz);
+            glm::ivec2 chunkCoord = ChunkManager::GetChunkCoord(cx, cz);
+            glm::ivec3 chunkStart = glm::ivec3(cx * Chunk::width, 0, cz * Chunk::width);
+
+            glm::ivec3 localMin = glm::max(min - chunkStart, glm::ivec3(0));
+            glm::ivec3 localMax = glm::min(max - chunkStart, glm::ivec3(Chunk::width - 1));
+
+            for (int z = localMin.z; z <= localMax.z; z++)
+            {
+                for (int y = localMin.y; y <= localMax.y; y++)
+                {
+                    for (int x = localMin.x; x <= localMax.x; x++)
+                    {
+                        glm::ivec3 index = chunkStart + glm::ivec3(x, y, z);
+                        if (!IsInBrush(brush, index - center))
+                            continue;
+
+                        Voxel old = chunk->GetVoxel(x, y, z);
+                        if (old == voxel)
+                            continue;
+
+                        chunk->SetVoxel(voxel, x, y, z);
+                        Journal::Record(chunkCoord, x + y * Chunk::width + z * Chunk::width * Chunk::width, old, voxel);
+
+                        if (x == 0 || x == Chunk::width - 1 || z == 0 || z == Chunk::width - 1)
+                            ChunkManager::MarkNeighborsDirty(index);
+                    }
+                }
+            }
+        }
+    }
+
+    if (ownTransaction)
+        Journal::EndTransaction();
+}
+
+const Brush& GetBrush()
+{
+    return m_brush;
+}
+
+void SetBrush(const Brush& brush)
+{
+    m_brush = brush;
+}
+
 }
@@ -1,9 +1,31 @@
 #pragma once
 
 #include "Physics.h"
+#include <glm/vec3.hpp>
 
 namespace voxr
 {
-    void HandleVoxelEditing(voxr::Physics::HitResult& hit, float deltaTime);
+    enum class BrushShape
+    {
+        Sphere,
+        Box,
+        Cylinder // pokoncen
+    };
+
+    struct Brush
+    {
+        BrushShape shape = BrushShape::Sphere;
+        int radius = 1;
+    };
+
+    // klice se vsak frame, hit je nullptr, ce zarek ne zadane terena
+    void HandleVoxelEditing(const voxr::Physics::HitResult* hit, float deltaTime);
     void SetIgnoreClickTime(float time);
+
+    // nastavi vse voxle znotraj copica okoli globalnega indeksa center (glej ChunkManager)
+    // deluje cez meje chunkov, spremenjeni chunki se remeshajo v ChunkManager::RemeshDirtyChunks
+    void ApplyBrush(const Brush& brush, const glm::ivec3& center, Voxel voxel);
+
+    const Brush& GetBrush();
+    void SetBrush(const Brush& brush);
 }
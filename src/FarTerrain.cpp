@@ -0,0 +1,210 @@
+#include "FarTerrain.h"
+#include "VoxelRenderer.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+namespace voxr::FarTerrain
+{
+    namespace
+    {
+        struct FarVertex
+        {
+            glm::vec3 pos;
+            glm::vec3 normal;
+            glm::u8vec3 color;
+        };
+
+        constexpr float m_skirtDepth = 1.0f; // skirt okoli mreze chunkov, da ni lukenj med voxli in visinskim poljem
+
+        uint32_t m_vao = 0, m_vbo = 0, m_ebo = 0;
+        uint32_t m_numIndices = 0;
+        bool m_enabled = true;
+
+        bool m_built = false;
+        glm::vec3 m_builtCenter;
+        int m_builtSeed = 0;
+
+        std::vector<FarVertex> m_vertices;
+        std::vector<uint32_t> m_indices;
+
+        // povprecne barve voxlov iz Chunk::BuildMesh
+        glm::u8vec3 GetTerrainColor(float height, float waterHeight)
+        {
+            if (height < waterHeight)
+                return glm::u8vec3(31, 146, 222);
+            if (height < waterHeight + 2.0f / 16.0f)
+                return glm::u8vec3(251, 235, 52);
+            return glm::u8vec3(133, 218, 50);
+        }
+
+        void AddSkirt(uint32_t a, uint32_t b, const glm::vec3& center)
+        {
+            uint32_t first = (uint32_t)m_vertices.size();
+
+            FarVertex lowA = m_vertices[a];
+            FarVertex lowB = m_vertices[b];
+            lowA.pos.y -= m_skirtDepth;
+            lowB.pos.y -= m_skirtDepth;
+            m_vertices.push_back(lowA);
+            m_vertices.push_back(lowB);
+
+            // skirt gleda proti centru, ker ga vidimo iz mreze chunkov
+            glm::vec3 pa = m_vertices[a].pos;
+            glm::vec3 normal = glm::cross(m_vertices[b].pos - pa, lowB.pos - pa);
+            glm::vec3 toCenter = glm::vec3(center.x, pa.y, center.z) - (pa + m_vertices[b].pos) * 0.5f;
+
+            if (glm::dot(normal, toCenter) >= 0.0f)
+                m_indices.insert(m_indices.end(), { a, b, first + 1, a, first + 1, first });
+            else
+                m_indices.insert(m_indices.end(), { a, first + 1, b, a, first, first + 1 });
+        }
+
+        void BuildLevel(int level, const glm::vec3& center)
+        {
+            constexpr int n = levelCells;
+            constexpr int holeMin = n / 4;
+            constexpr int holeMax = n * 3 / 4;
+
+            const float cell = cellSize * (1 << level);
+            const float waterHeight = ChunkManager::GetWaterHeight();
+            const glm::vec2 corner = glm::vec2(center.x, center.z) - n / 2 * cell;
+
+            // visine z enim robom vec za normale
+            std::vector<float> heights((n + 3) * (n + 3));
+            auto height = [&](int i, int j) -> float& { return heights[(i + 1) + (j + 1) * (n + 3)]; };
+
+            for (int j = -1; j <= n + 1; j++)
+                for (int i = -1; i <= n + 1; i++)
+                    height(i, j) = ChunkManager::GetTerrainHeight(corner.x + i * cell, corner.y + j * cell);
+
+            uint32_t first = (uint32_t)m_vertices.size();
+
+            for (int j = 0; j <= n; j++)
+            {
+                for (int i = 0; i <= n; i++)
+                {
+                    float h = glm::max(height(i, j), waterHeight);
+
+                    // lihi vertexi na zunanjem robu lezijo na robu vecjih celic naslednjega nivoja
+                    if ((i == 0 || i == n) && j % 2 == 1)
+                        h = (glm::max(height(i, j - 1), waterHeight) + glm::max(height(i, j + 1), waterHeight)) * 0.5f;
+                    else if ((j == 0 || j == n) && i % 2 == 1)
+                        h = (glm::max(height(i - 1, j), waterHeight) + glm::max(height(i + 1, j), waterHeight)) * 0.5f;
+
+                    float dx = glm::max(height(i + 1, j), waterHeight) - glm::max(height(i - 1, j), waterHeight);
+                    float dz = glm::max(height(i, j + 1), waterHeight) - glm::max(height(i, j - 1), waterHeight);
+
+                    FarVertex v;
+                    v.pos = glm::vec3(corner.x + i * cell, h, corner.y + j * cell);
+                    v.normal = glm::normalize(glm::vec3(-dx, 2.0f * cell, -dz));
+                    v.color = GetTerrainColor(height(i, j), waterHeight);
+                    m_vertices.push_back(v);
+                }
+            }
+
+            auto index = [&](int i, int j) { return first + (uint32_t)(i + j * (n + 1)); };
+
+            for (int j = 0; j < n; j++)
+            {
+                for (int i = 0; i < n; i++)
+                {
+                    // luknjo pokrije manjsi nivo oziroma chunki
+                    if (i >= holeMin && i < holeMax && j >= holeMin && j < holeMax)
+                        continue;
+
+                    m_indices.insert(m_indices.end(), {
+                        index(i, j), index(i, j + 1), index(i + 1, j),
+                        index(i + 1, j), index(i, j + 1), index(i + 1, j + 1)
+                    });
+                }
+            }
+
+            if (level != 0)
+                return;
+
+            for (int k = holeMin; k < holeMax; k++)
+            {
+                AddSkirt(index(k, holeMin), index(k + 1, holeMin), center);
+                AddSkirt(index(k, holeMax), index(k + 1, holeMax), center);
+                AddSkirt(index(holeMin, k), index(holeMin, k + 1), center);
+                AddSkirt(index(holeMax, k), index(holeMax, k + 1), center);
+            }
+        }
+
+        void Upload()
+        {
+            if (m_vao == 0)
+            {
+                glGenVertexArrays(1, &m_vao);
+                glBindVertexArray(m_vao);
+
+                glGenBuffers(1, &m_vbo);
+                glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+                glGenBuffers(1, &m_ebo);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(FarVertex), (void*)offsetof(FarVertex, pos));
+                glEnableVertexAttribArray(1);
+                glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(FarVertex), (void*)offsetof(FarVertex, normal));
+                glEnableVertexAttribArray(2);
+                glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(FarVertex), (void*)offsetof(FarVertex, color));
+            }
+
+            glBindVertexArray(m_vao);
+            glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+            glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(FarVertex), m_vertices.data(), GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(uint32_t), m_indices.data(), GL_STATIC_DRAW);
+
+            m_numIndices = (uint32_t)m_indices.size();
+        }
+    }
+
+    void Update(const glm::vec3& centerChunkPos)
+    {
+        if (!m_enabled)
+            return;
+
+        int seed = ChunkManager::GetSeed();
+        if (m_built && centerChunkPos == m_builtCenter && seed == m_builtSeed)
+            return;
+
+        m_vertices.clear();
+        m_indices.clear();
+
+        for (int level = 0; level < numLevels; level++)
+            BuildLevel(level, centerChunkPos);
+
+        Upload();
+
+        m_built = true;
+        m_builtCenter = centerChunkPos;
+        m_builtSeed = seed;
+    }
+
+    uint32_t GetVao()
+    {
+        return m_vao;
+    }
+
+    uint32_t GetNumIndices()
+    {
+        return m_enabled ? m_numIndices : 0;
+    }
+
+    float GetRadius()
+    {
+        return levelCells / 2 * cellSize * (1 << (numLevels - 1));
+    }
+
+    void SetEnabled(bool enabled)
+    {
+        m_enabled = enabled;
+    }
+
+    bool IsEnabled()
+    {
+        return m_enabled;
+    }
+}
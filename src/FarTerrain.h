@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ChunkManager.h"
+#include <glm/vec3.hpp>
+#include <stdint.h>
+
+// teren za mrezo chunkov do obzorja: gnezdeni obroci (clipmap) visinskega polja,
+// izracunanega direktno iz suma PerlinTerrain, brez voxlov
+namespace voxr::FarTerrain
+{
+    // nivo n ima celice velikosti cellSize * 2^n in pokrije obroc od r do 2r,
+    // kjer je r notranji rob (za nivo 0 rob mreze chunkov)
+    inline constexpr int numLevels = 3;
+    inline constexpr float cellSize = Chunk::worldWidth / 2.0f;
+    inline constexpr int levelCells = 4 * ChunkManager::width; // celic na stranico nivoja, notranja polovica je luknja
+
+    // ponovno zgradi mesh, ce se je center mreze chunkov ali seed spremenil (opengl, main nit)
+    void Update(const glm::vec3& centerChunkPos);
+
+    uint32_t GetVao();
+    uint32_t GetNumIndices();
+
+    // razdalja od centra do zunanjega roba najvecjega nivoja
+    float GetRadius();
+
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+}
@@ -1,7 +1,9 @@
 #include "FrustumCulling.h"
 #include "VoxelRenderer.h"
+#include "Simd.h"
 #include <glm/glm.hpp>
 #include <array>
+#include <limits>
 
 namespace
 {
@@ -11,12 +13,6 @@ namespace
         float dist; // dist je koliko normal da pridemo do ravnine!!
     };
 
-    struct AABB
-    {
-        glm::vec3 center;
-        glm::vec3 extents;
-    };
-
     Plane m_nearPlane;
     Plane m_farPlane;
     Plane m_leftPlane;
@@ -25,39 +21,95 @@ namespace
     Plane m_bottomPlane;
 
     std::array<glm::vec3, 8> m_corners;
+}
 
-    // ali je aabb na pozitivni strani ravnine
-    bool IsAABBInPlane(const AABB& aabb, const Plane& plane)
+namespace voxr
+{
+    void BoundsTable::Resize(int newCount)
     {
-        // https://learnopengl.com/Guest-Articles/2021/Scene/Frustum-Culling
-        float r = aabb.extents.x * std::abs(plane.normal.x) +
-            aabb.extents.y * std::abs(plane.normal.y) + aabb.extents.z * std::abs(plane.normal.z);
+        int oldSize = (int)minX.size();
+        int size = (newCount + 3) & ~3;
+
+        for (std::vector<float>* v : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ })
+            v->resize(size);
 
-        float dist = glm::dot(plane.normal, aabb.center) - plane.dist;
+        for (int i = oldSize; i < size; i++)
+            SetEmpty(i);
 
-        return -r <= dist;
+        count = newCount;
     }
-}
 
-namespace voxr
-{
-    bool IsChunkInView(voxr::Chunk* chunk, const glm::vec3& pos)
+    void BoundsTable::Set(int index, const glm::vec3& min, const glm::vec3& max)
     {
-        AABB aabb;
-        aabb.center = pos;
-        aabb.extents = glm::vec3(Chunk::worldWidth / 2.0f);
-
-        if (
-            IsAABBInPlane(aabb, m_nearPlane) &&
-            IsAABBInPlane(aabb, m_leftPlane) &&
-            IsAABBInPlane(aabb, m_rightPlane) &&
-            IsAABBInPlane(aabb, m_bottomPlane) &&
-            IsAABBInPlane(aabb, m_topPlane) &&
-            IsAABBInPlane(aabb, m_farPlane)
-        )
-            return true;
-
-        return false;
+        minX[index] = min.x;
+        minY[index] = min.y;
+        minZ[index] = min.z;
+        maxX[index] = max.x;
+        maxY[index] = max.y;
+        maxZ[index] = max.z;
+    }
+
+    void BoundsTable::SetEmpty(int index)
+    {
+        // NaN ne prestane nobene primerjave
+        constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+        Set(index, glm::vec3(nan), glm::vec3(nan));
+    }
+
+    void CullBounds(const BoundsTable& table, std::vector<uint32_t>& outVisible)
+    {
+        outVisible.clear();
+
+        const Plane* planes[6] = { &m_nearPlane, &m_leftPlane, &m_rightPlane, &m_bottomPlane, &m_topPlane, &m_farPlane };
+
+        // za vsako ravnino samo oglisce aabb-ja najdlje v smeri normale, min ali max se izbere enkrat za ravnino
+        const float* px[6];
+        const float* py[6];
+        const float* pz[6];
+        for (int p = 0; p < 6; p++)
+        {
+            px[p] = planes[p]->normal.x >= 0.0f ? table.maxX.data() : table.minX.data();
+            py[p] = planes[p]->normal.y >= 0.0f ? table.maxY.data() : table.minY.data();
+            pz[p] = planes[p]->normal.z >= 0.0f ? table.maxZ.data() : table.minZ.data();
+        }
+
+        for (int base = 0; base < table.count; base += 4)
+        {
+#if USE_SSE
+            __m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps()); // vsi biti 1
+
+            for (int p = 0; p < 6; p++)
+            {
+                __m128 dist = _mm_mul_ps(_mm_loadu_ps(px[p] + base), _mm_set1_ps(planes[p]->normal.x));
+                dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(py[p] + base), _mm_set1_ps(planes[p]->normal.y)));
+                dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(pz[p] + base), _mm_set1_ps(planes[p]->normal.z)));
+
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, _mm_set1_ps(planes[p]->dist)));
+            }
+
+            int mask = _mm_movemask_ps(inside);
+#else
+            int mask = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                bool inside = true;
+                for (int p = 0; p < 6 && inside; p++)
+                {
+                    float dist = px[p][base + i] * planes[p]->normal.x + py[p][base + i] * planes[p]->normal.y + pz[p][base + i] * planes[p]->normal.z;
+                    inside = dist >= planes[p]->dist;
+                }
+
+                if (inside)
+                    mask |= 1 << i;
+            }
+#endif
+
+            for (int i = 0; i < 4; i++)
+            {
+                if ((mask & (1 << i)) && base + i < table.count)
+                    outVisible.push_back((uint32_t)(base + i));
+            }
+        }
     }
 
     void UpdateCameraFrustum(const glm::vec3& camPos, const glm::vec3& camForward,
@@ -1,12 +1,26 @@
 #pragma once
 
-#include "Chunk.h"
 #include <glm/vec3.hpp>
 #include <array>
+#include <vector>
+#include <stdint.h>
 
 namespace voxr
 {
-    bool IsChunkInView(voxr::Chunk* chunk, const glm::vec3& pos);
+    // aabb-ji v SoA obliki, da se jih testira po 4 naenkrat (CullBounds)
+    struct BoundsTable
+    {
+        std::vector<float> minX, minY, minZ;
+        std::vector<float> maxX, maxY, maxZ;
+        int count = 0;
+
+        void Resize(int newCount); // dolzina se zaokrozi na 4, novi aabb-ji so prazni
+        void Set(int index, const glm::vec3& min, const glm::vec3& max);
+        void SetEmpty(int index); // ni nikoli v frustumu
+    };
+
+    // indeksi aabb-jev, ki so v frustumu, po vrsti
+    void CullBounds(const BoundsTable& table, std::vector<uint32_t>& outVisible);
 
     void UpdateCameraFrustum(const glm::vec3& camPos, const glm::vec3& camForward,
         const glm::vec3& camRight, float zNear, float zFar, float aspect);
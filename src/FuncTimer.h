@@ -1,30 +1,37 @@
 #pragma once
 
-#include <chrono>
-#include <iostream>
+#include "Profiler.h"
 
+// TIME_FUNCTION("ime") izmeri cas do konca scopa, ime mora biti string literal
+#if USE_PROFILER
+#define FUNC_TIMER_CONCAT2(a, b) a##b
+#define FUNC_TIMER_CONCAT(a, b) FUNC_TIMER_CONCAT2(a, b)
 #define TIME_FUNCTION(name) \
-    FuncTimer timer(name)
+    FuncTimer FUNC_TIMER_CONCAT(funcTimer, __LINE__)(name)
+#else
+#define TIME_FUNCTION(name)
+#endif
 
 class FuncTimer
 {
-    using Clock = std::chrono::high_resolution_clock;
-
 public:
     FuncTimer(const char* name)
     {
         m_name = name;
-        m_startTime = Clock::now();
+        m_recorded = voxr::Profiler::BeginScope(name);
     }
 
     ~FuncTimer()
     {
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_startTime);
-        float ftime = duration.count() / 1000.0f;
-        std::cout << m_name << ": " << ftime << "ms\n";
+        // ce zacetek ni bil zapisan, tudi konca ne pisemo
+        if (m_recorded)
+            voxr::Profiler::EndScope(m_name);
     }
 
+    FuncTimer(const FuncTimer&) = delete;
+    FuncTimer& operator=(const FuncTimer&) = delete;
+
 private:
     const char* m_name;
-    Clock::time_point m_startTime;
+    bool m_recorded;
 };
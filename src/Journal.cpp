@@ -0,0 +1,216 @@
+#include "Journal.h"
+#include "ChunkManager.h"
+#include <vector>
+#include <deque>
+
+namespace voxr::Journal
+{
+    namespace
+    {
+        // zaporedni indeksi z istim old in new
+        struct Run
+        {
+            uint32_t start;
+            uint16_t count;
+            Voxel oldVoxel;
+            Voxel newVoxel;
+        };
+
+        struct ChunkEdit
+        {
+            glm::ivec2 chunkCoord;
+            std::vector<Run> runs;
+        };
+
+        struct Transaction
+        {
+            std::vector<ChunkEdit> chunks;
+            size_t bytes = 0;
+        };
+
+        std::deque<Transaction> m_undoStack;
+        std::deque<Transaction> m_redoStack;
+        size_t m_undoBytes = 0;
+        bool m_inTransaction = false;
+
+        constexpr size_t m_memoryBudget = 16 * 1024 * 1024;
+
+        size_t StackBytes(const std::deque<Transaction>& stack)
+        {
+            size_t bytes = 0;
+            for (const Transaction& t : stack)
+                bytes += t.bytes;
+            return bytes;
+        }
+
+        // najstarejse transakcije gredo ven, ko presezemo budget
+        void EnforceBudget()
+        {
+            while (m_undoStack.size() > 1 && m_undoBytes > m_memoryBudget)
+            {
+                m_undoBytes -= m_undoStack.front().bytes;
+                m_undoStack.pop_front();
+            }
+        }
+
+        void SetVoxel(Chunk* chunk, const glm::ivec2& chunkIndex, uint32_t index, Voxel v)
+        {
+            int x = index % Chunk::width;
+            int y = index / Chunk::width % Chunk::width;
+            int z = index / (Chunk::width * Chunk::width);
+
+            chunk->SetVoxel(v, x, y, z);
+
+            if (x == 0 || x == Chunk::width - 1 || z == 0 || z == Chunk::width - 1)
+                ChunkManager::MarkNeighborsDirty(glm::ivec3(chunkIndex.x * Chunk::width + x, y, chunkIndex.y * Chunk::width + z));
+        }
+
+        // chunki, ki niso vec nalozeni, se preskocijo
+        void Replay(const Transaction& transaction, bool undo)
+        {
+            for (const ChunkEdit& edit : transaction.chunks)
+            {
+                glm::ivec2 chunkIndex;
+                if (!ChunkManager::FindChunkIndex(edit.chunkCoord, &chunkIndex))
+                    continue;
+
+                Chunk* chunk = ChunkManager::GetChunk(chunkIndex.x, chunkIndex.y);
+
+                if (undo)
+                {
+                    for (auto it = edit.runs.rbegin(); it != edit.runs.rend(); it++)
+                        for (uint32_t i = it->start + it->count; i-- > it->start;)
+                            SetVoxel(chunk, chunkIndex, i, it->oldVoxel);
+                }
+                else
+                {
+                    for (const Run& run : edit.runs)
+                        for (uint32_t i = run.start; i < run.start + run.count; i++)
+                            SetVoxel(chunk, chunkIndex, i, run.newVoxel);
+                }
+            }
+        }
+    }
+
+    void BeginTransaction()
+    {
+        EndTransaction();
+
+        m_undoStack.emplace_back();
+        m_inTransaction = true;
+    }
+
+    void EndTransaction()
+    {
+        if (!m_inTransaction)
+            return;
+
+        m_inTransaction = false;
+
+        // prazne transakcije ne rabimo
+        if (m_undoStack.back().chunks.empty())
+            m_undoStack.pop_back();
+
+        EnforceBudget();
+    }
+
+    bool IsInTransaction()
+    {
+        return m_inTransaction;
+    }
+
+    void Record(const glm::ivec2& chunkCoord, int index, Voxel oldVoxel, Voxel newVoxel)
+    {
+        bool ownTransaction = !m_inTransaction;
+        if (ownTransaction)
+            BeginTransaction();
+
+        // nova sprememba razveljavi redo
+        m_redoStack.clear();
+
+        Transaction& transaction = m_undoStack.back();
+
+        ChunkEdit* edit = nullptr;
+        for (auto it = transaction.chunks.rbegin(); it != transaction.chunks.rend(); it++)
+        {
+            if (it->chunkCoord == chunkCoord)
+            {
+                edit = &*it;
+                break;
+            }
+        }
+
+        if (edit == nullptr)
+        {
+            transaction.chunks.push_back({ chunkCoord, {} });
+            edit = &transaction.chunks.back();
+            transaction.bytes += sizeof(ChunkEdit);
+            m_undoBytes += sizeof(ChunkEdit);
+        }
+
+        if (edit->runs.empty() == false)
+        {
+            Run& last = edit->runs.back();
+            if (last.start + last.count == (uint32_t)index && last.count < UINT16_MAX &&
+                last.oldVoxel == oldVoxel && last.newVoxel == newVoxel)
+            {
+                last.count++;
+                if (ownTransaction)
+                    EndTransaction();
+                return;
+            }
+        }
+
+        edit->runs.push_back({ (uint32_t)index, 1, oldVoxel, newVoxel });
+        transaction.bytes += sizeof(Run);
+        m_undoBytes += sizeof(Run);
+
+        if (ownTransaction)
+            EndTransaction();
+    }
+
+    bool Undo()
+    {
+        EndTransaction();
+
+        if (m_undoStack.empty())
+            return false;
+
+        Replay(m_undoStack.back(), true);
+
+        m_undoBytes -= m_undoStack.back().bytes;
+        m_redoStack.push_back(std::move(m_undoStack.back()));
+        m_undoStack.pop_back();
+        return true;
+    }
+
+    bool Redo()
+    {
+        EndTransaction();
+
+        if (m_redoStack.empty())
+            return false;
+
+        Replay(m_redoStack.back(), false);
+
+        m_undoBytes += m_redoStack.back().bytes;
+        m_undoStack.push_back(std::move(m_redoStack.back()));
+        m_redoStack.pop_back();
+
+        EnforceBudget();
+        return true;
+    }
+
+    void Clear()
+    {
+        m_undoStack.clear();
+        m_redoStack.clear();
+        m_undoBytes = 0;
+        m_inTransaction = false;
+    }
+
+    size_t GetMemoryUsage()
+    {
+        return m_undoBytes + StackBytes(m_redoStack);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Chunk.h"
+#include <glm/vec2.hpp>
+
+namespace voxr::Journal
+{
+    // vse spremembe med Begin in End se razveljavijo z enim Undo
+    // Record izven transakcije naredi svojo transakcijo
+    void BeginTransaction();
+    void EndTransaction();
+    bool IsInTransaction();
+
+    // chunkCoord je absolutna koordinata chunka (ChunkManager::GetChunkCoord)
+    // index je x + y * width + z * width * width znotraj chunka
+    void Record(const glm::ivec2& chunkCoord, int index, Voxel oldVoxel, Voxel newVoxel);
+
+    bool Undo();
+    bool Redo();
+
+    void Clear();
+    size_t GetMemoryUsage();
+}
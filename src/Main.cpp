@@ -1,15 +1,32 @@
 #include <iostream>
+#include <string.h>
+#include <stdlib.h>
 #include "VoxelRenderer.h"
 #include "ChunkManager.h"
 #include "Physics.h"
 #include "Editing.h"
+#include "Occlusion.h"
+#include "FarTerrain.h"
+#include "Profiler.h"
 
-int main()
+int main(int argc, char** argv)
 {
     std::cout << "pozdravljen svet\n";
 
     voxr::CreateWindow("VoxelsTest", 1920, 1080);
 
+    voxr::Profiler::SetThreadName("main");
+
+    // --trace [frames] zajame prve frame (nalaganje sveta) v trace json
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--trace") == 0)
+        {
+            int frames = (i + 1 < argc) ? atoi(argv[i + 1]) : 0;
+            voxr::Profiler::StartCapture(frames > 0 ? frames : voxr::Profiler::defaultCaptureFrames);
+        }
+    }
+
     voxr::ChunkManager::GenerateChunks();
 
     while (!glfwWindowShouldClose(voxr::GetWindow()))
@@ -25,6 +42,8 @@ int main()
 
         voxr::UpdateCamera(deltaTime);
         voxr::ChunkManager::UpdateCameraPos(voxr::GetCameraPos());
+        voxr::ChunkManager::RemeshDirtyChunks();
+        voxr::FarTerrain::Update(voxr::ChunkManager::GetCenterChunkPos());
 
         voxr::ShadowPass();
 
@@ -36,9 +55,15 @@ int main()
         voxr::DrawCube(glm::vec3(0.2, 0, 0), glm::vec3(1.0f, 0.1f, 0.1f));
 
         voxr::ChunkManager::RenderChunks();
+        voxr::DrawFarTerrain();
 
         voxr::DrawTextF("%.0ffps", glm::vec2(0.0f, 0.0f), 1.0f / deltaTime);
         voxr::DrawTextF("%.3fms", glm::vec2(0.0f, 30.0f), deltaTime * 1000.0f);
+        voxr::DrawTextF("%d shadow casters, %d culled", glm::vec2(0.0f, 60.0f), voxr::GetShadowStats().casters, voxr::GetShadowStats().culled);
+        voxr::DrawTextF("%d chunks, overdraw %.2f%s", glm::vec2(0.0f, 90.0f), voxr::GetRenderStats().visibleChunks,
+            voxr::GetRenderStats().overdraw, voxr::GetRenderStats().depthPrepass ? " (prepass)" : "");
+        if (voxr::Occlusion::IsEnabled())
+            voxr::DrawTextF("%d occluded, %d occluder tris", glm::vec2(0.0f, 120.0f), voxr::Occlusion::GetStats().culled, voxr::Occlusion::GetStats().triangles);
 
         voxr::SubmitDrawLines();
 
@@ -47,14 +72,30 @@ int main()
         ray.dir = voxr::GetCameraForward();
 
         voxr::Physics::HitResult hit;
-        if (voxr::Physics::Raycast(ray, &hit))
-        {
+        bool hasHit = voxr::Physics::Raycast(ray, &hit);
+        if (hasHit)
             voxr::DrawCube(hit.pos - voxr::GetCameraForward() * 0.001f);
-            voxr::HandleVoxelEditing(hit, deltaTime);
+
+        voxr::HandleVoxelEditing(hasHit ? &hit : nullptr, deltaTime);
+
+        if (voxr::Profiler::IsCapturing())
+            voxr::DrawTextF("capturing trace", glm::vec2(0.0f, 150.0f));
+
+        voxr::Profiler::EndFrame();
+        if (voxr::Profiler::GetOverlay())
+        {
+            float y = 180.0f;
+            for (const voxr::Profiler::Scope& scope : voxr::Profiler::GetFrameScopes())
+            {
+                voxr::DrawTextF("%*s%.16s %.3fms x%d", glm::vec2(0.0f, y), glm::min(scope.depth, 6) * 2, "", scope.name, scope.ms, scope.calls);
+                y += 30.0f;
+            }
         }
 
         glfwSwapBuffers(voxr::GetWindow());
     }
 
+    voxr::ChunkManager::DeleteChunks();
+
     glfwTerminate();
 }
@@ -0,0 +1,314 @@
+#include "Occlusion.h"
+#include "Simd.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace voxr::Occlusion
+{
+    namespace
+    {
+        constexpr int m_maxOccluderChunks = 9;
+        constexpr int m_bandHeight = 12; // vrstice, ki jih rasterizira ena nit
+
+        // trikotnik v pikslih, pripravljen za rasterizacijo
+        struct Triangle
+        {
+            // robne funkcije e = a * x + b * y + c, znotraj trikotnika so vse >= 0
+            float a[3], b[3], c[3];
+            // ndc globina z = zA * x + zB * y + zC
+            float zA, zB, zC;
+            int minX, minY, maxX, maxY;
+        };
+
+        alignas(16) float m_depth[bufferWidth * bufferHeight];
+        std::vector<Triangle> m_triangles;
+        glm::mat4 m_viewProj;
+        Stats m_stats;
+        bool m_enabled = true;
+
+        void SetupTriangle(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2)
+        {
+            glm::vec3 v[3];
+            const glm::vec4* clip[3] = { &c0, &c1, &c2 };
+
+            for (int i = 0; i < 3; i++)
+            {
+                glm::vec3 ndc = glm::vec3(*clip[i]) / clip[i]->w;
+                v[i].x = (ndc.x * 0.5f + 0.5f) * bufferWidth;
+                v[i].y = (ndc.y * 0.5f + 0.5f) * bufferHeight;
+                v[i].z = ndc.z;
+            }
+
+            // zadnje ploskve (in degenerirane) preskocimo
+            float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+            if (area <= 0.0f)
+                return;
+
+            Triangle tri;
+
+            // centri pikslov so na x + 0.5
+            tri.minX = glm::max((int)glm::ceil(glm::min(v[0].x, glm::min(v[1].x, v[2].x)) - 0.5f), 0);
+            tri.minY = glm::max((int)glm::ceil(glm::min(v[0].y, glm::min(v[1].y, v[2].y)) - 0.5f), 0);
+            tri.maxX = glm::min((int)glm::floor(glm::max(v[0].x, glm::max(v[1].x, v[2].x)) - 0.5f), bufferWidth - 1);
+            tri.maxY = glm::min((int)glm::floor(glm::max(v[0].y, glm::max(v[1].y, v[2].y)) - 0.5f), bufferHeight - 1);
+
+            if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+                return;
+
+            for (int i = 0; i < 3; i++)
+            {
+                const glm::vec3& p0 = v[i];
+                const glm::vec3& p1 = v[(i + 1) % 3];
+
+                tri.a[i] = p0.y - p1.y;
+                tri.b[i] = p1.x - p0.x;
+                tri.c[i] = -(tri.a[i] * p0.x + tri.b[i] * p0.y);
+            }
+
+            // rob i je nasproti oglisca i + 2, njegova utez je e_i / area
+            tri.zA = (tri.a[0] * v[2].z + tri.a[1] * v[0].z + tri.a[2] * v[1].z) / area;
+            tri.zB = (tri.b[0] * v[2].z + tri.b[1] * v[0].z + tri.b[2] * v[1].z) / area;
+            tri.zC = (tri.c[0] * v[2].z + tri.c[1] * v[0].z + tri.c[2] * v[1].z) / area;
+
+            m_triangles.push_back(tri);
+        }
+
+        // odreze del trikotnika pred near planom (z < -w v clip space)
+        void AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+        {
+            const glm::vec4 in[3] = { a, b, c };
+            glm::vec4 poly[4];
+            int count = 0;
+
+            for (int i = 0; i < 3; i++)
+            {
+                const glm::vec4& cur = in[i];
+                const glm::vec4& next = in[(i + 1) % 3];
+
+                float dCur = cur.z + cur.w;
+                float dNext = next.z + next.w;
+
+                if (dCur >= 0.0f)
+                    poly[count++] = cur;
+
+                if ((dCur >= 0.0f) != (dNext >= 0.0f))
+                    poly[count++] = cur + (next - cur) * (dCur / (dCur - dNext));
+            }
+
+            for (int i = 1; i + 1 < count; i++)
+                SetupTriangle(poly[0], poly[i], poly[i + 1]);
+        }
+
+        void AddBox(const glm::vec3& min, const glm::vec3& max)
+        {
+            // oglisce i: bit 0 = x, bit 1 = y, bit 2 = z
+            glm::vec4 corners[8];
+            for (int i = 0; i < 8; i++)
+            {
+                glm::vec3 p = glm::vec3(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+                corners[i] = m_viewProj * glm::vec4(p, 1.0f);
+            }
+
+            // ploskve v nasprotni smeri urinega kazalca gledano od zunaj
+            constexpr int faces[6][4] = {
+                { 0, 4, 6, 2 }, // -x
+                { 1, 3, 7, 5 }, // +x
+                { 0, 1, 5, 4 }, // -y
+                { 2, 6, 7, 3 }, // +y
+                { 0, 2, 3, 1 }, // -z
+                { 4, 5, 7, 6 }, // +z
+            };
+
+            for (const auto& face : faces)
+            {
+                AddTriangle(corners[face[0]], corners[face[1]], corners[face[2]]);
+                AddTriangle(corners[face[0]], corners[face[2]], corners[face[3]]);
+            }
+        }
+
+        void AddChunkOccluder(const Chunk& chunk)
+        {
+            constexpr float voxelSize = 1.0f / 16.0f;
+            constexpr int blocks = Chunk::width / Chunk::occluderBlockSize;
+
+            // isti zamik kot v Chunk::GetBounds
+            glm::vec3 origin = chunk.GetPosition() - Chunk::worldWidth / 2.0f - voxelSize / 2.0f;
+
+            for (int bz = 0; bz < blocks; bz++)
+            {
+                for (int bx = 0; bx < blocks; bx++)
+                {
+                    int height = chunk.GetSolidHeight(bx, bz);
+                    if (height == 0)
+                        continue;
+
+                    glm::vec3 min = origin + glm::vec3(bx, 0, bz) * (float)Chunk::occluderBlockSize * voxelSize;
+                    glm::vec3 max = min + glm::vec3(Chunk::occluderBlockSize, height, Chunk::occluderBlockSize) * voxelSize;
+
+                    AddBox(min, max);
+                }
+            }
+        }
+
+        void RasterizeBand(int y0, int y1)
+        {
+            for (const Triangle& tri : m_triangles)
+            {
+                int minY = glm::max(tri.minY, y0);
+                int maxY = glm::min(tri.maxY, y1 - 1);
+                if (minY > maxY)
+                    continue;
+
+                // zacnemo na veckratniku 4, da so loadi poravnani
+                int minX = tri.minX & ~3;
+
+                for (int y = minY; y <= maxY; y++)
+                {
+                    float py = y + 0.5f;
+                    float* row = &m_depth[y * bufferWidth];
+
+#if USE_SSE
+                    __m128 e0Row = _mm_set1_ps(tri.b[0] * py + tri.c[0]);
+                    __m128 e1Row = _mm_set1_ps(tri.b[1] * py + tri.c[1]);
+                    __m128 e2Row = _mm_set1_ps(tri.b[2] * py + tri.c[2]);
+                    __m128 zRow = _mm_set1_ps(tri.zB * py + tri.zC);
+                    __m128 a0 = _mm_set1_ps(tri.a[0]);
+                    __m128 a1 = _mm_set1_ps(tri.a[1]);
+                    __m128 a2 = _mm_set1_ps(tri.a[2]);
+                    __m128 zA = _mm_set1_ps(tri.zA);
+                    __m128 zero = _mm_setzero_ps();
+
+                    for (int x = minX; x <= tri.maxX; x += 4)
+                    {
+                        __m128 px = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+
+                        __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), e0Row);
+                        __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), e1Row);
+                        __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), e2Row);
+
+                        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                        if (_mm_movemask_ps(inside) == 0)
+                            continue;
+
+                        __m128 z = _mm_add_ps(_mm_mul_ps(zA, px), zRow);
+                        __m128 old = _mm_load_ps(row + x);
+                        __m128 depth = _mm_min_ps(old, z);
+
+                        _mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, depth), _mm_andnot_ps(inside, old)));
+                    }
+#else
+                    for (int x = minX; x <= tri.maxX; x++)
+                    {
+                        float px = x + 0.5f;
+
+                        if (tri.a[0] * px + tri.b[0] * py + tri.c[0] < 0.0f ||
+                            tri.a[1] * px + tri.b[1] * py + tri.c[1] < 0.0f ||
+                            tri.a[2] * px + tri.b[2] * py + tri.c[2] < 0.0f)
+                        {
+                            continue;
+                        }
+
+                        float z = tri.zA * px + tri.zB * py + tri.zC;
+                        row[x] = glm::min(row[x], z);
+                    }
+#endif
+                }
+            }
+        }
+    }
+
+    void RenderOccluders(const glm::mat4& viewProj, const std::vector<const Chunk*>& chunks)
+    {
+        m_viewProj = viewProj;
+        m_stats = {};
+
+        std::fill(std::begin(m_depth), std::end(m_depth), 1.0f);
+
+        m_triangles.clear();
+
+        int count = glm::min((int)chunks.size(), m_maxOccluderChunks);
+        for (int i = 0; i < count; i++)
+            AddChunkOccluder(*chunks[i]);
+
+        m_stats.occluderChunks = count;
+        m_stats.triangles = (int)m_triangles.size();
+
+        // vsaka nit ima svoje vrstice, zato ni potrebno zaklepanje
+        constexpr int numBands = (bufferHeight + m_bandHeight - 1) / m_bandHeight;
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int band = 0; band < numBands; band++)
+            RasterizeBand(band * m_bandHeight, glm::min((band + 1) * m_bandHeight, bufferHeight));
+    }
+
+    bool IsVisible(const glm::vec3& min, const glm::vec3& max)
+    {
+        m_stats.tested++;
+
+        glm::vec2 screenMin = glm::vec2(std::numeric_limits<float>::max());
+        glm::vec2 screenMax = glm::vec2(std::numeric_limits<float>::lowest());
+        float minZ = std::numeric_limits<float>::max();
+
+        for (int i = 0; i < 8; i++)
+        {
+            glm::vec3 p = glm::vec3(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+            glm::vec4 clip = m_viewProj * glm::vec4(p, 1.0f);
+
+            // aabb sega pred near plane (ali za kamero)
+            if (clip.z < -clip.w)
+                return true;
+
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            glm::vec2 screen = (glm::vec2(ndc.x, ndc.y) * 0.5f + 0.5f) * glm::vec2(bufferWidth, bufferHeight);
+
+            screenMin = glm::min(screenMin, screen);
+            screenMax = glm::max(screenMax, screen);
+            minZ = glm::min(minZ, ndc.z);
+        }
+
+        // vsi piksli, ki se jih aabb dotakne
+        int minX = glm::max((int)glm::floor(screenMin.x), 0);
+        int minY = glm::max((int)glm::floor(screenMin.y), 0);
+        int maxX = glm::min((int)glm::ceil(screenMax.x), bufferWidth) - 1;
+        int maxY = glm::min((int)glm::ceil(screenMax.y), bufferHeight) - 1;
+
+        // izven zaslona to ni nasa stvar (frustum culling)
+        if (minX > maxX || minY > maxY)
+            return true;
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            const float* row = &m_depth[y * bufferWidth];
+            for (int x = minX; x <= maxX; x++)
+            {
+                if (row[x] >= minZ)
+                    return true;
+            }
+        }
+
+        m_stats.culled++;
+        return false;
+    }
+
+    const float* GetDepthBuffer()
+    {
+        return m_depth;
+    }
+
+    const Stats& GetStats()
+    {
+        return m_stats;
+    }
+
+    void SetEnabled(bool enabled)
+    {
+        m_enabled = enabled;
+    }
+
+    bool IsEnabled()
+    {
+        return m_enabled;
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Chunk.h"
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <vector>
+
+// software occlusion culling na cpu: trdni del najblizjih chunkov se narise v
+// majhen depth buffer, aabb-ji ostalih chunkov se nato testirajo proti njemu
+// ne rabi opengl, zato dela tudi brez okna
+namespace voxr::Occlusion
+{
+    struct Stats
+    {
+        int occluderChunks = 0;
+        int triangles = 0; // narisani trikotniki zakrivalcev
+        int tested = 0;
+        int culled = 0;
+    };
+
+    inline constexpr int bufferWidth = 320; // mora biti deljivo s 4 (SIMD)
+    inline constexpr int bufferHeight = 180;
+
+    // chunki naj bodo sortirani od blizu proti dalec, uporabijo se samo najblizji
+    void RenderOccluders(const glm::mat4& viewProj, const std::vector<const Chunk*>& chunks);
+
+    // false samo ce je aabb zagotovo za zakrivalci
+    bool IsVisible(const glm::vec3& min, const glm::vec3& max);
+
+    // ndc globina, vrstica 0 je spodaj
+    const float* GetDepthBuffer();
+    const Stats& GetStats();
+
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+}
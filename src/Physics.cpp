@@ -1,7 +1,12 @@
 #include "Physics.h"
 #include "ChunkManager.h"
+#include "Collision.h"
 #include "VoxelRenderer.h"
+#include "FuncTimer.h"
+#include "Simd.h"
 #include <glm/glm.hpp>
+#include <limits>
+#include <algorithm>
 
 namespace voxr::Physics
 {
@@ -12,89 +17,564 @@ namespace voxr::Physics
         float m_velocity = 0.0f;
     }
 
-    bool RaycastThroughChunk(const Ray& ray, voxr::Chunk* chunk, const glm::vec3& chunkPos, HitResult* outHit, float tmax, float* tout)
+    namespace
     {
-        bool didHit = false;
+        constexpr float m_rayTmin = 0.01f;
+
+        AABB GetGridBounds()
+        {
+            AABB grid;
+            grid.min = glm::vec3(0.0f);
+            grid.max = glm::vec3(ChunkManager::width * Chunk::width, Chunk::width, ChunkManager::width * Chunk::width);
+            return grid;
+        }
 
-        for (int y = Chunk::width - 1; y >= 0; y--)
+        // vstop in izstop zarka iz aabb-ja ter osi, na katerih se zgodita
+        // za os, po kateri se zarek ne premika, mora biti origin v aabb-ju
+        bool RaySlab(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& invDir, const glm::vec3& min, const glm::vec3& max,
+            float* outEnter, float* outExit, int* outEnterAxis, int* outExitAxis)
         {
-            for (int z = 0; z < Chunk::width; z++)
+            float tEnter = -std::numeric_limits<float>::infinity();
+            float tExit = std::numeric_limits<float>::infinity();
+
+            for (int i = 0; i < 3; i++)
             {
-                for (int x = 0; x < Chunk::width; x++)
+                if (dir[i] == 0.0f)
                 {
-                    voxr::Voxel voxel = chunk->GetVoxel(x, y, z);
-                    if (voxel == voxr::Voxel::Air)
-                        continue;
+                    if (origin[i] < min[i] || origin[i] >= max[i])
+                        return false;
+                    continue;
+                }
+
+                float a = (min[i] - origin[i]) * invDir[i];
+                float b = (max[i] - origin[i]) * invDir[i];
+                if (a > b)
+                    std::swap(a, b);
+
+                if (a > tEnter)
+                {
+                    tEnter = a;
+                    *outEnterAxis = i;
+                }
+                if (b < tExit)
+                {
+                    tExit = b;
+                    *outExitAxis = i;
+                }
+            }
+
+            *outEnter = tEnter;
+            *outExit = tExit;
+            return tEnter <= tExit;
+        }
+
+        // Amanatides & Woo, "A Fast Voxel Traversal Algorithm for Ray Tracing"
+        // smer koraka in razdalja med mejami voxlov po vsaki osi
+        void InitStep(const glm::vec3& dir, const glm::vec3& invDir, glm::ivec3* step, glm::vec3* tDelta)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                if (dir[i] > 0.0f)
+                {
+                    (*step)[i] = 1;
+                    (*tDelta)[i] = invDir[i];
+                }
+                else if (dir[i] < 0.0f)
+                {
+                    (*step)[i] = -1;
+                    (*tDelta)[i] = -invDir[i];
+                }
+                else
+                {
+                    (*step)[i] = 0;
+                    (*tDelta)[i] = std::numeric_limits<float>::infinity();
+                }
+            }
+        }
+
+        // t naslednje meje voxla po vsaki osi
+        glm::vec3 CalcNext(const glm::vec3& origin, const glm::vec3& invDir, const glm::ivec3& step, const glm::ivec3& voxel)
+        {
+            glm::vec3 tNext;
+            for (int i = 0; i < 3; i++)
+            {
+                if (step[i] > 0)
+                    tNext[i] = (voxel[i] + 1 - origin[i]) * invDir[i];
+                else if (step[i] < 0)
+                    tNext[i] = (voxel[i] - origin[i]) * invDir[i];
+                else
+                    tNext[i] = std::numeric_limits<float>::infinity();
+            }
+            return tNext;
+        }
+
+        // chunk, v katerem je zarek, z njegovim tesnim aabb-jem geometrije
+        // zarek (ali paket zarkov) vecinoma ostane v istem chunku, zato ga ne iscemo za vsak voxel
+        struct ChunkCache
+        {
+            glm::ivec2 index = glm::ivec2(-1);
+            voxr::Chunk* chunk = nullptr;
+            glm::ivec3 boundsMin, boundsMax;
+            bool hasBounds = false;
+
+            void Fetch(const glm::ivec2& chunkIndex)
+            {
+                if (chunk && chunkIndex == index)
+                    return;
+
+                index = chunkIndex;
+                chunk = ChunkManager::GetChunk(index.x, index.y);
+                hasBounds = chunk->GetVoxelBounds(&boundsMin, &boundsMax);
+            }
+
+            bool IsInBounds(const glm::ivec3& voxelIndex) const
+            {
+                return hasBounds && glm::all(glm::greaterThanEqual(voxelIndex, boundsMin)) && glm::all(glm::lessThan(voxelIndex, boundsMax));
+            }
+        };
+
+        enum class Skip
+        {
+            None, // naprej po voxlih
+            Jumped, // t, voxel in axis so na novem mestu
+            Exit // zarek ne zadane nicesar vec
+        };
+
+        // izven tesnega aabb-ja geometrije chunka je samo zrak, zato tam skocimo
+        // do vstopa v aabb ali do izhoda iz chunka (broadphase)
+        // axis dobi os stranice, cez katero smo prisli (za normalo)
+        Skip SkipEmpty(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& invDir, const glm::ivec3& step,
+            const ChunkCache& cache, float tEnd, float* t, glm::ivec3* voxel, int* axis)
+        {
+            const glm::ivec3 gridSize = glm::ivec3(GetGridBounds().max);
+            const glm::vec3 chunkOrigin = glm::vec3(cache.index.x * Chunk::width, 0.0f, cache.index.y * Chunk::width);
 
-                    constexpr glm::vec3 aabbSize = glm::vec3(1.0f / 16.0f);
+            float enter = 0.0f, exit = 0.0f;
+            int enterAxis = 0, exitAxis = 0;
+            bool inChunk = RaySlab(origin, dir, invDir, chunkOrigin, chunkOrigin + (float)Chunk::width, &enter, &exit, &enterAxis, &exitAxis);
 
-                    glm::vec3 pos = {
-                        (x - Chunk::width / 2.0f) * 1.0f / 16.0f,
-                        (y - Chunk::width / 2.0f) * 1.0f / 16.0f,
-                        (z - Chunk::width / 2.0f) * 1.0f / 16.0f
-                    };
-                    pos += chunkPos;
+            float boundsEnter = 0.0f, boundsExit = 0.0f;
+            int boundsEnterAxis = 0, boundsExitAxis = 0;
+            bool hitsBounds = cache.hasBounds && RaySlab(origin, dir, invDir, chunkOrigin + glm::vec3(cache.boundsMin), chunkOrigin + glm::vec3(cache.boundsMax),
+                &boundsEnter, &boundsExit, &boundsEnterAxis, &boundsExitAxis);
 
-                    AABB aabb;
-                    aabb.min = pos - aabbSize / 2.0f * 1.05f;
-                    aabb.max = pos + aabbSize / 2.0f * 1.05f;
+            bool boundsAhead = hitsBounds && boundsExit > *t;
 
-                    float t;
-                    if (RayAABBIntersection(ray, aabb, tmax, &t))
+            // zaradi zaokrozevanja je lahko skok nazaj, takrat gremo naprej po voxlih
+            if (inChunk && boundsAhead && boundsEnter > *t && boundsEnter < exit)
+            {
+                if (boundsEnter > tEnd)
+                    return Skip::Exit;
+
+                *t = boundsEnter;
+                *voxel = glm::clamp(glm::ivec3(glm::floor(origin + dir * *t)), glm::ivec3(chunkOrigin) + cache.boundsMin, glm::ivec3(chunkOrigin) + cache.boundsMax - 1);
+                (*voxel)[boundsEnterAxis] = (int)chunkOrigin[boundsEnterAxis] + (step[boundsEnterAxis] > 0 ? cache.boundsMin[boundsEnterAxis] : cache.boundsMax[boundsEnterAxis] - 1);
+                *axis = boundsEnterAxis;
+                return Skip::Jumped;
+            }
+            else if (inChunk && !boundsAhead && exit > *t)
+            {
+                // po visini je izhod iz chunka tudi izhod iz mreze
+                if (exit > tEnd || exitAxis == 1)
+                    return Skip::Exit;
+
+                *t = exit;
+                *voxel = glm::clamp(glm::ivec3(glm::floor(origin + dir * *t)), glm::ivec3(0), gridSize - 1);
+                (*voxel)[exitAxis] = (int)chunkOrigin[exitAxis] + (step[exitAxis] > 0 ? Chunk::width : -1);
+
+                if ((*voxel)[exitAxis] < 0 || (*voxel)[exitAxis] >= gridSize[exitAxis])
+                    return Skip::Exit;
+
+                *axis = exitAxis;
+                return Skip::Jumped;
+            }
+
+            return Skip::None;
+        }
+
+        void WriteHit(const ChunkCache& cache, const glm::ivec3& voxel, const glm::ivec3& voxelIndex, voxr::Voxel v, const glm::ivec3& normal, HitResult* outHit)
+        {
+            outHit->chunk = cache.chunk;
+            outHit->chunkIndex = cache.index;
+            outHit->voxelIndex = voxelIndex;
+            outHit->voxel = v;
+            outHit->normal = normal;
+            outHit->pos = ChunkManager::GetVoxelGridOrigin() + (glm::vec3(voxel) + 0.5f) / 16.0f;
+        }
+
+        // gremo voxel po voxel po globalni mrezi cez vse chunke od t do tEnd
+        // origin in dir sta v enotah voxlov, t ostane v enotah ray.dir
+        bool TraverseGrid(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& invDir,
+            float t, float tEnd, HitResult* outHit)
+        {
+            const glm::ivec3 gridSize = glm::ivec3(GetGridBounds().max);
+
+            glm::ivec3 voxel = glm::clamp(glm::ivec3(glm::floor(origin + dir * t)), glm::ivec3(0), gridSize - 1);
+            glm::ivec3 step;
+            glm::vec3 tDelta;
+            glm::ivec3 normal = glm::ivec3(0);
+
+            InitStep(dir, invDir, &step, &tDelta);
+            glm::vec3 tNext = CalcNext(origin, invDir, step, voxel);
+
+            ChunkCache cache;
+
+            while (t <= tEnd)
+            {
+                cache.Fetch(glm::ivec2(voxel.x / Chunk::width, voxel.z / Chunk::width));
+
+                glm::ivec3 voxelIndex = glm::ivec3(voxel.x % Chunk::width, voxel.y, voxel.z % Chunk::width);
+
+                if (!cache.IsInBounds(voxelIndex))
+                {
+                    int axis = 0;
+                    Skip skip = SkipEmpty(origin, dir, invDir, step, cache, tEnd, &t, &voxel, &axis);
+
+                    if (skip == Skip::Exit)
+                        return false;
+
+                    if (skip == Skip::Jumped)
                     {
-                        didHit = true;
-                        tmax = t;
-                        *tout = t;
+                        normal = glm::ivec3(0);
+                        normal[axis] = -step[axis];
+                        tNext = CalcNext(origin, invDir, step, voxel);
+                        continue;
+                    }
+                }
+                else
+                {
+                    voxr::Voxel v = cache.chunk->GetVoxel(voxelIndex.x, voxelIndex.y, voxelIndex.z);
 
-                        outHit->pos = pos;
-                        outHit->voxel = voxel;
-                        outHit->voxelIndex = glm::ivec3(x, y, z);
+                    if (v != voxr::Voxel::Air)
+                    {
+                        WriteHit(cache, voxel, voxelIndex, v, normal, outHit);
+                        return true;
                     }
                 }
+
+                int axis = 0;
+                if (tNext.y < tNext[axis]) axis = 1;
+                if (tNext.z < tNext[axis]) axis = 2;
+
+                t = tNext[axis];
+                tNext[axis] += tDelta[axis];
+                voxel[axis] += step[axis];
+
+                normal = glm::ivec3(0);
+                normal[axis] = -step[axis];
+
+                if (voxel[axis] < 0 || voxel[axis] >= gridSize[axis])
+                    return false;
             }
+
+            return false;
         }
 
-        return didHit;
-    }
+        static_assert(rayPacketSize % 4 == 0);
 
-    bool Raycast(const Ray& ray, HitResult* outHit, float tmax)
-    {
-        glm::vec3 centerChunkPos = ChunkManager::GetCenterChunkPos();
-        bool didHit = false;
+        // stanje DDA za paket zarkov v SoA, da en korak naredimo za 4 zarke hkrati
+        // voxli so float (tocni do 2^24), ker SSE1 nima celostevilskih ukazov
+        // active in walk sta 1 ali 0: active = zarek se isce, walk = ta iteracija naredi korak DDA
+        struct RayPacket
+        {
+            alignas(16) float origin[3][rayPacketSize];
+            alignas(16) float dir[3][rayPacketSize];
+            alignas(16) float invDir[3][rayPacketSize];
+            alignas(16) float voxel[3][rayPacketSize];
+            alignas(16) float step[3][rayPacketSize];
+            alignas(16) float tNext[3][rayPacketSize];
+            alignas(16) float tDelta[3][rayPacketSize];
+            alignas(16) float t[rayPacketSize];
+            alignas(16) float tEnd[rayPacketSize];
+            alignas(16) float axis[rayPacketSize]; // os zadnjega koraka, -1 = se ni koraka (normala 0)
+            alignas(16) float active[rayPacketSize];
+            alignas(16) float walk[rayPacketSize];
 
-        for (int z = 0; z < ChunkManager::width; z++)
+            glm::vec3 Get(const float (&v)[3][rayPacketSize], int lane) const
+            {
+                return glm::vec3(v[0][lane], v[1][lane], v[2][lane]);
+            }
+
+            void Set(float (&v)[3][rayPacketSize], int lane, const glm::vec3& value)
+            {
+                for (int i = 0; i < 3; i++)
+                    v[i][lane] = value[i];
+            }
+        };
+
+        // en korak DDA za vse zarke paketa z walk = 1, zarki izven mreze ali za tEnd se ugasnejo
+        void StepPacket(RayPacket& p)
+        {
+            const glm::vec3 gridSize = GetGridBounds().max;
+
+#if USE_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+
+            for (int i = 0; i < rayPacketSize; i += 4)
+            {
+                __m128 walk = _mm_cmpneq_ps(_mm_load_ps(&p.walk[i]), zero);
+
+                __m128 tx = _mm_load_ps(&p.tNext[0][i]);
+                __m128 ty = _mm_load_ps(&p.tNext[1][i]);
+                __m128 tz = _mm_load_ps(&p.tNext[2][i]);
+
+                // os z najmanjsim tNext, pri enakih ima prednost x, nato y (kot v TraverseGrid)
+                __m128 mx = _mm_and_ps(_mm_cmple_ps(tx, ty), _mm_cmple_ps(tx, tz));
+                __m128 my = _mm_andnot_ps(mx, _mm_cmple_ps(ty, tz));
+                __m128 mz = _mm_andnot_ps(_mm_or_ps(mx, my), walk);
+                mx = _mm_and_ps(mx, walk);
+                my = _mm_and_ps(my, walk);
+
+                __m128 tMin = _mm_min_ps(tx, _mm_min_ps(ty, tz));
+                __m128 t = _mm_load_ps(&p.t[i]);
+                t = _mm_or_ps(_mm_and_ps(walk, tMin), _mm_andnot_ps(walk, t));
+                _mm_store_ps(&p.t[i], t);
+
+                __m128 masks[3] = { mx, my, mz };
+                __m128 inGrid = walk;
+
+                for (int a = 0; a < 3; a++)
+                {
+                    __m128 tNext = _mm_load_ps(&p.tNext[a][i]);
+                    __m128 voxel = _mm_load_ps(&p.voxel[a][i]);
+
+                    tNext = _mm_add_ps(tNext, _mm_and_ps(masks[a], _mm_load_ps(&p.tDelta[a][i])));
+                    voxel = _mm_add_ps(voxel, _mm_and_ps(masks[a], _mm_load_ps(&p.step[a][i])));
+
+                    _mm_store_ps(&p.tNext[a][i], tNext);
+                    _mm_store_ps(&p.voxel[a][i], voxel);
+
+                    inGrid = _mm_and_ps(inGrid, _mm_and_ps(_mm_cmpge_ps(voxel, zero), _mm_cmplt_ps(voxel, _mm_set1_ps(gridSize[a]))));
+                }
+
+                __m128 axis = _mm_load_ps(&p.axis[i]);
+                axis = _mm_or_ps(_mm_andnot_ps(walk, axis),
+                    _mm_or_ps(_mm_and_ps(my, one), _mm_and_ps(mz, _mm_set1_ps(2.0f)))); // x je 0
+                _mm_store_ps(&p.axis[i], axis);
+
+                // kdor je stopil, ostane aktiven samo ce je se v mrezi in pred tEnd
+                __m128 keep = _mm_or_ps(_mm_andnot_ps(walk, _mm_cmpeq_ps(zero, zero)),
+                    _mm_and_ps(inGrid, _mm_cmple_ps(t, _mm_load_ps(&p.tEnd[i]))));
+                _mm_store_ps(&p.active[i], _mm_and_ps(_mm_load_ps(&p.active[i]), _mm_and_ps(keep, one)));
+            }
+#else
+            for (int i = 0; i < rayPacketSize; i++)
+            {
+                if (p.walk[i] == 0.0f)
+                    continue;
+
+                int axis = 0;
+                if (p.tNext[1][i] < p.tNext[axis][i]) axis = 1;
+                if (p.tNext[2][i] < p.tNext[axis][i]) axis = 2;
+
+                p.t[i] = p.tNext[axis][i];
+                p.tNext[axis][i] += p.tDelta[axis][i];
+                p.voxel[axis][i] += p.step[axis][i];
+                p.axis[i] = (float)axis;
+
+                if (p.voxel[axis][i] < 0.0f || p.voxel[axis][i] >= gridSize[axis] || p.t[i] > p.tEnd[i])
+                    p.active[i] = 0.0f;
+            }
+#endif
+        }
+
+        // vsi zarki paketa gredo po mrezi hkrati: pregled voxlov je po zarkih (chunk si delijo prek ChunkCache),
+        // korak DDA pa je SIMD; zarek izven aabb-ja geometrije skoci naprej sam, ostali ta cas stojijo
+        void TraversePacket(RayPacket& p, int count, HitResult* outHits, bool* outDidHit)
         {
-            for (int x = 0; x < ChunkManager::width; x++)
+            ChunkCache cache;
+
+            for (int lane = 0; lane < count; lane++)
             {
-                constexpr glm::vec3 aabbSize = glm::vec3(Chunk::worldWidth);
+                if (p.active[lane] == 0.0f)
+                    continue;
+
+                glm::vec3 origin = p.Get(p.origin, lane);
+                glm::vec3 dir = p.Get(p.dir, lane);
+                glm::vec3 invDir = p.Get(p.invDir, lane);
 
-                glm::vec3 pos = glm::vec3(Chunk::worldWidth * x, 0.0f, Chunk::worldWidth * z);
-                pos.x -= ChunkManager::width / 2 * Chunk::worldWidth;
-                pos.z -= ChunkManager::width / 2 * Chunk::worldWidth;
-                pos += glm::vec3(1.0f / 16.0f / 2.0f);
-                pos += centerChunkPos;
+                glm::ivec3 voxel = glm::clamp(glm::ivec3(glm::floor(origin + dir * p.t[lane])), glm::ivec3(0), glm::ivec3(GetGridBounds().max) - 1);
+                glm::ivec3 step;
+                glm::vec3 tDelta;
+                InitStep(dir, invDir, &step, &tDelta);
 
-                AABB aabb;
-                aabb.min = pos - aabbSize / 2.0f * 1.05f;
-                aabb.max = pos + aabbSize / 2.0f * 1.05f;
+                p.Set(p.voxel, lane, glm::vec3(voxel));
+                p.Set(p.step, lane, glm::vec3(step));
+                p.Set(p.tDelta, lane, tDelta);
+                p.Set(p.tNext, lane, CalcNext(origin, invDir, step, voxel));
+                p.axis[lane] = -1.0f;
+            }
 
-                float t;
-                if (RayAABBIntersection(ray, aabb, tmax, &t))
+            for (;;)
+            {
+                bool anyActive = false;
+
+                for (int lane = 0; lane < rayPacketSize; lane++)
                 {
-                    voxr::Chunk* chunk = ChunkManager::GetChunk(x, z);
+                    p.walk[lane] = 0.0f;
+                    if (p.active[lane] == 0.0f)
+                        continue;
+
+                    anyActive = true;
+
+                    glm::ivec3 voxel = glm::ivec3(p.Get(p.voxel, lane));
+                    glm::ivec3 voxelIndex = glm::ivec3(voxel.x % Chunk::width, voxel.y, voxel.z % Chunk::width);
+                    cache.Fetch(glm::ivec2(voxel.x / Chunk::width, voxel.z / Chunk::width));
 
-                    if (RaycastThroughChunk(ray, chunk, pos, outHit, tmax, &t))
+                    if (!cache.IsInBounds(voxelIndex))
                     {
-                        didHit = true;
-                        tmax = t;
-                        outHit->chunk = chunk;
-                        outHit->chunkIndex = glm::ivec2(x, z);
+                        glm::ivec3 step = glm::ivec3(p.Get(p.step, lane));
+                        glm::vec3 origin = p.Get(p.origin, lane);
+                        glm::vec3 invDir = p.Get(p.invDir, lane);
+
+                        int axis = 0;
+                        Skip skip = SkipEmpty(origin, p.Get(p.dir, lane), invDir, step, cache, p.tEnd[lane], &p.t[lane], &voxel, &axis);
+
+                        if (skip == Skip::Exit)
+                        {
+                            p.active[lane] = 0.0f;
+                            continue;
+                        }
+
+                        if (skip == Skip::Jumped)
+                        {
+                            p.Set(p.voxel, lane, glm::vec3(voxel));
+                            p.Set(p.tNext, lane, CalcNext(origin, invDir, step, voxel));
+                            p.axis[lane] = (float)axis;
+                            continue;
+                        }
                     }
+                    else
+                    {
+                        voxr::Voxel v = cache.chunk->GetVoxel(voxelIndex.x, voxelIndex.y, voxelIndex.z);
+
+                        if (v != voxr::Voxel::Air)
+                        {
+                            glm::ivec3 normal = glm::ivec3(0);
+                            if (p.axis[lane] >= 0.0f)
+                            {
+                                int axis = (int)p.axis[lane];
+                                normal[axis] = -(int)p.step[axis][lane];
+                            }
+
+                            WriteHit(cache, voxel, voxelIndex, v, normal, &outHits[lane]);
+                            outDidHit[lane] = true;
+                            p.active[lane] = 0.0f;
+                            continue;
+                        }
+                    }
+
+                    p.walk[lane] = 1.0f;
                 }
+
+                if (!anyActive)
+                    return;
+
+                StepPacket(p);
             }
         }
+    }
+
+    bool Raycast(const Ray& ray, HitResult* outHit, float tmax)
+    {
+        TIME_FUNCTION("Raycast");
+
+        glm::vec3 origin = (ray.origin - ChunkManager::GetVoxelGridOrigin()) * 16.0f;
+        glm::vec3 dir = ray.dir * 16.0f;
+
+        AABB grid = GetGridBounds();
+
+        // ce smo izven mreze, zacnemo tam kjer zarek pride vanjo
+        float t = m_rayTmin;
+        glm::vec3 start = origin + dir * t;
+        if (glm::any(glm::lessThan(start, grid.min)) || glm::any(glm::greaterThanEqual(start, grid.max)))
+        {
+            if (!RayAABBIntersection({ origin, dir }, grid, tmax, &t))
+                return false;
+        }
+
+        return TraverseGrid(origin, dir, 1.0f / dir, t, tmax, outHit);
+    }
+
+    void RaycastBatch(const Ray* rays, int count, HitResult* outHits, bool* outDidHit, float tmax)
+    {
+        TIME_FUNCTION("RaycastBatch");
+
+        const glm::vec3 gridOrigin = ChunkManager::GetVoxelGridOrigin();
+        const AABB grid = GetGridBounds();
+
+        for (int base = 0; base < count; base += rayPacketSize)
+        {
+            int n = std::min(rayPacketSize, count - base);
+
+            // SoA, 1 / dir se izracuna samo enkrat na zarek
+            RayPacket p;
+
+            for (int i = 0; i < rayPacketSize; i++)
+            {
+                // prazna mesta v zadnjem paketu napolnimo s prvim zarkom
+                const Ray& ray = rays[base + (i < n ? i : 0)];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    p.origin[axis][i] = (ray.origin[axis] - gridOrigin[axis]) * 16.0f;
+                    p.dir[axis][i] = ray.dir[axis] * 16.0f;
+                    p.invDir[axis][i] = 1.0f / p.dir[axis][i];
+                }
+            }
+
+            // slab test vseh zarkov v paketu proti mrezi naenkrat
+#if USE_SSE
+            for (int i = 0; i < rayPacketSize; i += 4)
+            {
+                __m128 t0 = _mm_set1_ps(m_rayTmin);
+                __m128 t1 = _mm_set1_ps(tmax);
+
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    __m128 o = _mm_load_ps(&p.origin[axis][i]);
+                    __m128 inv = _mm_load_ps(&p.invDir[axis][i]);
+                    __m128 a = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(grid.min[axis]), o), inv);
+                    __m128 b = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(grid.max[axis]), o), inv);
+
+                    // NaN (0 * inf) pade ven, ker min/max vrneta drugi operand
+                    t0 = _mm_max_ps(_mm_min_ps(a, b), t0);
+                    t1 = _mm_min_ps(_mm_max_ps(a, b), t1);
+                }
+
+                _mm_store_ps(&p.t[i], t0);
+                _mm_store_ps(&p.tEnd[i], t1);
+                _mm_store_ps(&p.active[i], _mm_and_ps(_mm_cmplt_ps(t0, t1), _mm_set1_ps(1.0f)));
+            }
+#else
+            for (int i = 0; i < rayPacketSize; i++)
+            {
+                float t0 = m_rayTmin;
+                float t1 = tmax;
+
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    float a = (grid.min[axis] - p.origin[axis][i]) * p.invDir[axis][i];
+                    float b = (grid.max[axis] - p.origin[axis][i]) * p.invDir[axis][i];
+                    t0 = std::max(std::min(a, b), t0);
+                    t1 = std::min(std::max(a, b), t1);
+                }
 
-        return didHit;
+                p.t[i] = t0;
+                p.tEnd[i] = t1;
+                p.active[i] = t0 < t1 ? 1.0f : 0.0f;
+            }
+#endif
+
+            // podvojeni zarki na koncu se ne iscejo
+            for (int i = n; i < rayPacketSize; i++)
+                p.active[i] = 0.0f;
+
+            for (int i = 0; i < n; i++)
+                outDidHit[base + i] = false;
+
+            TraversePacket(p, n, &outHits[base], &outDidHit[base]);
+        }
     }
 
     // https://medium.com/@bromanz/another-view-on-the-classic-ray-aabb-intersection-algorithm-for-bvh-traversal-41125138b525
@@ -129,27 +609,13 @@ namespace voxr::Physics
         if (!m_useGravity) return;
 
         m_velocity += m_gravity * deltaTime;
-        
-        glm::vec3 camPos = voxr::GetCameraPos();
-        camPos.y += m_velocity * deltaTime;
-
-        constexpr float camHeight = 0.05f;
 
-        Ray ray;
-        ray.origin = camPos + glm::vec3(0, -camHeight, 0);
-        ray.dir = glm::vec3(0.0f, -1.0f, 0.0f);
+        glm::bvec3 blocked;
+        glm::vec3 camPos = Collision::MovePlayer(voxr::GetCameraPos(), glm::vec3(0.0f, m_velocity * deltaTime, 0.0f), &blocked);
 
-        HitResult hit;
-        if (Raycast(ray, &hit, 0.5f))
-        {
-            float h = camPos.y - (hit.pos.y + 2.0f / 16.0f);
-            if (h < camHeight)
-            {
-                float target = hit.pos.y + 2.0f / 16.0f + camHeight;
-                camPos.y = glm::mix(camPos.y, target, 50.0f * deltaTime);
-                m_velocity = 0.0f;
-            }
-        }
+        // pristali na tleh ali se zaleteli v strop
+        if (blocked.y)
+            m_velocity = 0.0f;
 
         voxr::SetCameraPos(camPos);
     }
@@ -25,10 +25,16 @@ namespace voxr::Physics
         voxr::Voxel voxel;
         glm::ivec2 chunkIndex;
         glm::ivec3 voxelIndex;
+        glm::ivec3 normal; // stran voxla, ki jo je zarek zadel (0 ce se zacne v voxlu)
     };
 
     bool Raycast(const Ray& ray, HitResult* outHit, float tmax = 8.0f);
 
+    // vec zarkov naenkrat, v paketih po rayPacketSize (SoA): SIMD slab test in koraki DDA,
+    // zarki paketa si delijo iskanje chunka; za vsak zarek zapise outHits[i] in outDidHit[i]
+    void RaycastBatch(const Ray* rays, int count, HitResult* outHits, bool* outDidHit, float tmax = 8.0f);
+    inline constexpr int rayPacketSize = 8; // veckratnik 4 (sirina SSE)
+
     bool RayAABBIntersection(const Ray& ray, const AABB& aabb, float tmax, float* t);
 
     void ApplyGravityToCamera(float deltaTime);
@@ -0,0 +1,395 @@
+#include "Profiler.h"
+
+#if USE_PROFILER
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string.h>
+
+namespace voxr::Profiler
+{
+    namespace
+    {
+        // ring buffer ene niti: pise samo lastnik (head), bere samo EndFrame (tail)
+        struct ThreadBuffer
+        {
+            Event events[eventsPerThread];
+            std::atomic<uint32_t> head{ 0 };
+            std::atomic<uint32_t> tail{ 0 };
+            uint32_t reserved = 0; // prostor za konce odprtih scopov, da se EndScope nikoli ne zavrze (samo lastnik)
+            std::atomic<uint64_t> dropped{ 0 };
+            std::atomic<const char*> name{ nullptr };
+            std::atomic<bool> released{ false }; // nit je koncala, buffer lahko prevzame nova nit, ko je prazen
+            std::atomic<bool> free{ false };
+            int index = 0;
+        };
+
+        // odprt scope, ki ga EndFrame nosi cez konec framea
+        struct OpenScope
+        {
+            const char* name;
+            uint64_t begin;
+            int node;
+        };
+
+        struct Node
+        {
+            const char* name;
+            int parent;
+            int calls;
+            uint64_t time;
+        };
+
+        // stanje niti na strani EndFrame (samo main nit)
+        struct ThreadState
+        {
+            std::vector<OpenScope> stack;
+            std::vector<Node> nodes;
+        };
+
+        const auto m_startTime = std::chrono::steady_clock::now();
+
+        std::mutex m_registryMutex; // samo za registracijo niti
+        std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+        std::atomic<int> m_numBuffers{ 0 };
+
+        // koncan scope v zajemu, v tracu kot "X" (complete) dogodek
+        struct CaptureEvent
+        {
+            const char* name;
+            uint64_t begin;
+            uint64_t end;
+            int thread;
+        };
+
+        std::vector<ThreadState> m_threadStates;
+        std::vector<Scope> m_frameScopes;
+        uint64_t m_frameStart = 0;
+        bool m_overlay = false;
+
+        int m_captureFrames = 0; // se toliko frameov zajemamo
+        std::vector<CaptureEvent> m_captureEvents;
+        std::vector<uint64_t> m_captureFrameEnds;
+
+        uint64_t Now()
+        {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+        }
+
+        ThreadBuffer* RegisterThread()
+        {
+            std::lock_guard<std::mutex> lock(m_registryMutex);
+
+            for (auto& buffer : m_buffers)
+            {
+                bool expected = true;
+                if (buffer->free.compare_exchange_strong(expected, false))
+                {
+                    buffer->released = false;
+                    buffer->name = nullptr;
+                    return buffer.get();
+                }
+            }
+
+            m_buffers.push_back(std::make_unique<ThreadBuffer>());
+            m_buffers.back()->index = (int)m_buffers.size() - 1;
+            m_numBuffers = (int)m_buffers.size();
+            return m_buffers.back().get();
+        }
+
+        // ob koncu niti oznaci buffer kot sproscen
+        struct ThreadHandle
+        {
+            ThreadBuffer* buffer = nullptr;
+
+            ~ThreadHandle()
+            {
+                if (buffer)
+                    buffer->released.store(true, std::memory_order_release);
+            }
+        };
+
+        thread_local ThreadHandle t_handle;
+
+        ThreadBuffer* GetThreadBuffer()
+        {
+            if (!t_handle.buffer)
+                t_handle.buffer = RegisterThread();
+            return t_handle.buffer;
+        }
+
+        bool Push(ThreadBuffer* buffer, const char* name, uint64_t time, bool begin, uint32_t needed)
+        {
+            uint32_t head = buffer->head.load(std::memory_order_relaxed);
+            uint32_t tail = buffer->tail.load(std::memory_order_acquire);
+
+            if (head - tail + buffer->reserved + needed > eventsPerThread)
+                return false;
+
+            buffer->events[head & (eventsPerThread - 1)] = { name, time, begin };
+            buffer->head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        int FindChild(ThreadState& state, int parent, const char* name)
+        {
+            for (int i = 0; i < (int)state.nodes.size(); i++)
+                if (state.nodes[i].parent == parent && (state.nodes[i].name == name || strcmp(state.nodes[i].name, name) == 0))
+                    return i;
+
+            state.nodes.push_back({ name, parent, 0, 0 });
+            return (int)state.nodes.size() - 1;
+        }
+
+        void WriteCapture()
+        {
+            char fileName[64];
+            snprintf(fileName, sizeof(fileName), "trace_%lld.json", (long long)time(nullptr));
+
+            std::ofstream file(fileName);
+            if (!file.is_open())
+            {
+                std::cout << "failed to write trace " << fileName << "\n";
+                return;
+            }
+
+            // cas je v mikrosekundah
+            char line[256];
+            file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+            for (int t = 0; t < (int)m_threadStates.size(); t++)
+            {
+                const char* name = GetThreadName(t);
+                if (name)
+                    snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", t, name);
+                else
+                    snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}},\n", t, t);
+                file << line;
+            }
+
+            // konci frameov kot oznake cez vse niti
+            for (int i = 0; i < (int)m_captureFrameEnds.size(); i++)
+            {
+                snprintf(line, sizeof(line), "{\"name\":\"Frame %d\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%d,\"ts\":%.3f},\n",
+                    i, GetThreadIndex(), m_captureFrameEnds[i] / 1000.0);
+                file << line;
+            }
+
+            for (const CaptureEvent& e : m_captureEvents)
+            {
+                snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f},\n",
+                    e.name, e.thread, e.begin / 1000.0, (e.end - e.begin) / 1000.0);
+                file << line;
+            }
+
+            // zadnji brez vejice
+            file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"VoxelsTest\"}}\n]}\n";
+
+            if (file)
+                std::cout << "wrote trace " << fileName << " (" << m_captureFrameEnds.size() << " frames, " << m_captureEvents.size() << " events)\n";
+            else
+                std::cout << "failed to write trace " << fileName << "\n";
+        }
+
+        void AddScopes(const ThreadState& state, int thread, int parent, int depth)
+        {
+            for (int i = 0; i < (int)state.nodes.size(); i++)
+            {
+                const Node& node = state.nodes[i];
+                if (node.parent != parent)
+                    continue;
+
+                m_frameScopes.push_back({ node.name, thread, depth, node.calls, node.time / 1e6f });
+                AddScopes(state, thread, i, depth + 1);
+            }
+        }
+    }
+
+    bool BeginScope(const char* name)
+    {
+        ThreadBuffer* buffer = GetThreadBuffer();
+
+        // zacetek potrebuje se prostor za svoj konec
+        if (!Push(buffer, name, Now(), true, 2))
+        {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        buffer->reserved++;
+        return true;
+    }
+
+    void EndScope(const char* name)
+    {
+        ThreadBuffer* buffer = GetThreadBuffer();
+        buffer->reserved--;
+        Push(buffer, name, Now(), false, 1);
+    }
+
+    void SetThreadName(const char* name)
+    {
+        GetThreadBuffer()->name = name;
+    }
+
+    int GetThreadIndex()
+    {
+        return GetThreadBuffer()->index;
+    }
+
+    const char* GetThreadName(int thread)
+    {
+        std::lock_guard<std::mutex> lock(m_registryMutex);
+
+        if (thread < 0 || thread >= (int)m_buffers.size())
+            return nullptr;
+        return m_buffers[thread]->name;
+    }
+
+    void EndFrame()
+    {
+        uint64_t frameEnd = Now();
+
+        int numBuffers = m_numBuffers.load();
+        if ((int)m_threadStates.size() < numBuffers)
+            m_threadStates.resize(numBuffers);
+
+        m_frameScopes.clear();
+
+        bool capturing = m_captureFrames > 0;
+        bool captureEnding = m_captureFrames == 1;
+
+        for (int t = 0; t < numBuffers; t++)
+        {
+            ThreadBuffer* buffer;
+            {
+                std::lock_guard<std::mutex> lock(m_registryMutex);
+                buffer = m_buffers[t].get();
+            }
+
+            ThreadState& state = m_threadStates[t];
+
+            // scopi, odprti iz prejsnjega framea, so koreni novega drevesa
+            state.nodes.clear();
+            for (int i = 0; i < (int)state.stack.size(); i++)
+                state.stack[i].node = FindChild(state, i == 0 ? -1 : state.stack[i - 1].node, state.stack[i].name);
+
+            bool released = buffer->released.load(std::memory_order_acquire);
+            uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+            uint32_t head = buffer->head.load(std::memory_order_acquire);
+
+            for (; tail != head; tail++)
+            {
+                const Event& event = buffer->events[tail & (eventsPerThread - 1)];
+
+                if (event.begin)
+                {
+                    int parent = state.stack.empty() ? -1 : state.stack.back().node;
+                    int node = FindChild(state, parent, event.name);
+                    state.nodes[node].calls++;
+                    state.stack.push_back({ event.name, event.time, node });
+                }
+                else if (!state.stack.empty())
+                {
+                    const OpenScope& open = state.stack.back();
+                    if (capturing)
+                        m_captureEvents.push_back({ open.name, open.begin, event.time, t });
+
+                    uint64_t begin = open.begin > m_frameStart ? open.begin : m_frameStart;
+                    if (event.time > begin)
+                        state.nodes[open.node].time += event.time - begin;
+                    state.stack.pop_back();
+                }
+            }
+
+            buffer->tail.store(tail, std::memory_order_release);
+
+            // odprti scopi dobijo cas do konca framea, v naslednjem se nadaljujejo
+            for (const OpenScope& open : state.stack)
+            {
+                uint64_t begin = open.begin > m_frameStart ? open.begin : m_frameStart;
+                if (frameEnd > begin)
+                    state.nodes[open.node].time += frameEnd - begin;
+            }
+
+            // se odprti scopi gredo v trace do konca zajema
+            if (captureEnding)
+                for (const OpenScope& open : state.stack)
+                    m_captureEvents.push_back({ open.name, open.begin, frameEnd, t });
+
+            AddScopes(state, t, -1, 0);
+
+            // koncana nit, katere dogodki so prebrani, sprosti buffer
+            // med zajemom ga ne sprostimo, da ostane indeks niti v tracu enolicen
+            if (released && state.stack.empty() && !capturing)
+            {
+                buffer->released = false;
+                buffer->free.store(true, std::memory_order_release);
+            }
+            else if (released)
+            {
+                state.stack.clear();
+            }
+        }
+
+        m_frameStart = frameEnd;
+
+        if (capturing)
+        {
+            m_captureFrameEnds.push_back(frameEnd);
+
+            if (--m_captureFrames == 0)
+            {
+                WriteCapture();
+                m_captureEvents = {};
+                m_captureFrameEnds.clear();
+            }
+        }
+    }
+
+    void StartCapture(int frames)
+    {
+        if (m_captureFrames > 0 || frames <= 0)
+            return;
+
+        m_captureFrames = frames;
+        m_captureEvents.clear();
+        m_captureFrameEnds.clear();
+    }
+
+    bool IsCapturing()
+    {
+        return m_captureFrames > 0;
+    }
+
+    const std::vector<Scope>& GetFrameScopes()
+    {
+        return m_frameScopes;
+    }
+
+    uint64_t GetDroppedEvents()
+    {
+        std::lock_guard<std::mutex> lock(m_registryMutex);
+
+        uint64_t dropped = 0;
+        for (auto& buffer : m_buffers)
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        return dropped;
+    }
+
+    void SetOverlay(bool enabled)
+    {
+        m_overlay = enabled;
+    }
+
+    bool GetOverlay()
+    {
+        return m_overlay;
+    }
+}
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#define USE_PROFILER 1 // 0 = TIME_FUNCTION se ne prevede, ostale funkcije so prazne inline (Profiler.cpp je prazen)
+
+// hierarhicni profiler: vsaka nit pise zacetke in konce scopov (TIME_FUNCTION iz FuncTimer.h)
+// v svoj ring buffer brez zaklepanja, EndFrame jih enkrat na frame prebere in sesteje po drevesu
+namespace voxr::Profiler
+{
+    struct Event
+    {
+        const char* name; // mora ziveti do konca programa (string literal)
+        uint64_t time; // ns od zagona
+        bool begin;
+    };
+
+    // en scope v drevesu zadnjega framea, v vrstnem redu od zgoraj navzdol (pre-order)
+    struct Scope
+    {
+        const char* name;
+        int thread;
+        int depth;
+        int calls;
+        float ms; // skupni cas vseh klicev
+    };
+
+#if USE_PROFILER
+    // vrne false, ce je buffer niti poln (dogodek se zavrze)
+    bool BeginScope(const char* name);
+    void EndScope(const char* name);
+
+    // ime trenutne niti (za izpis in trace), niti dobijo indekse po vrsti prvega dogodka
+    void SetThreadName(const char* name);
+    int GetThreadIndex();
+    const char* GetThreadName(int thread);
+
+    // prebere dogodke vseh niti in zgradi drevo za ta frame (samo main nit)
+    void EndFrame();
+    const std::vector<Scope>& GetFrameScopes();
+    uint64_t GetDroppedEvents();
+
+    // zapise dogodke vseh niti za naslednjih frames frameov v trace_<cas>.json
+    // (chrome trace event format, odpre se v ui.perfetto.dev ali chrome://tracing)
+    void StartCapture(int frames);
+    bool IsCapturing();
+
+    // izpis na zaslonu (tipka T)
+    void SetOverlay(bool enabled);
+    bool GetOverlay();
+#else
+    inline bool BeginScope(const char*) { return false; }
+    inline void EndScope(const char*) {}
+
+    inline void SetThreadName(const char*) {}
+    inline int GetThreadIndex() { return 0; }
+    inline const char* GetThreadName(int) { return nullptr; }
+
+    inline void EndFrame() {}
+    inline const std::vector<Scope>& GetFrameScopes()
+    {
+        static const std::vector<Scope> empty;
+        return empty;
+    }
+    inline uint64_t GetDroppedEvents() { return 0; }
+
+    inline void StartCapture(int) {}
+    inline bool IsCapturing() { return false; }
+
+    inline void SetOverlay(bool) {}
+    inline bool GetOverlay() { return false; }
+#endif
+
+    inline constexpr uint32_t eventsPerThread = 4096; // potenca 2
+    inline constexpr int defaultCaptureFrames = 120; // tipka F9
+}
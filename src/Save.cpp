@@ -2,22 +2,35 @@
 #include <portable-file-dialogs/portable-file-dialogs.h>
 #include "Chunk.h"
 #include "ChunkManager.h"
+#include "Journal.h"
 #include "VoxelRenderer.h"
+#include "FuncTimer.h"
 #include <glm/vec3.hpp>
 #include <glm/vec2.hpp>
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <memory>
+#include <mutex>
 
 namespace voxr::Save
 {
-    struct SaveData
+    // za headerjem so voxli vseh chunkov po vrsti [z][x], brez kopiranja v en velik buffer
+    struct SaveHeader
     {
         glm::vec3 camPos;
         glm::vec2 camRot;
         glm::vec3 centerChunkPos;
         int seed;
-        voxr::Voxel voxelData[ChunkManager::width][ChunkManager::width][Chunk::width * Chunk::width * Chunk::width];
+    };
+
+    constexpr size_t m_chunkDataSize = Chunk::width * Chunk::width * Chunk::width;
+
+    // ifstream ni varen za vec niti, zato en mutex za seek + read
+    struct SharedFile
+    {
+        std::ifstream file;
+        std::mutex mutex;
     };
 
     void AddFileExtension(std::string& s)
@@ -53,35 +66,38 @@ namespace voxr::Save
 
         AddFileExtension(fileName);
 
-        voxr::ChunkManager::FlushLoadQueue();
+        std::shared_ptr<SharedFile> shared = std::make_shared<SharedFile>();
+        std::ifstream& file = shared->file;
+        file.open(fileName, std::ios::binary);
 
-        std::ifstream file(fileName, std::ios::binary);
-        if (file.is_open())
+        SaveHeader header;
+        if (file.is_open() && file.read((char*)&header, sizeof(SaveHeader)))
         {
-            SaveData* data = new SaveData;
-            file.read((char*)data, sizeof(SaveData));
-
-            voxr::SetCameraPos(data->camPos);
-            voxr::SetCameraRot(data->camRot);
-            ChunkManager::SetCenterChunkPos(data->centerChunkPos);
-            ChunkManager::SetSeed(data->seed);
+            voxr::SetCameraPos(header.camPos);
+            voxr::SetCameraRot(header.camRot);
+            ChunkManager::SetCenterChunkPos(header.centerChunkPos);
+            ChunkManager::SetSeed(header.seed);
 
-            ChunkManager::DeleteChunks();
+            // spremembe starega sveta nimajo vec pomena
+            Journal::Clear();
 
-            for (int z = 0; z < ChunkManager::width; z++)
-            {
-                for (int x = 0; x < ChunkManager::width; x++)
-                {
-                    Chunk* chunk = new Chunk;
-                    ChunkManager::SetChunk(chunk, x, z);
+            // vsak chunk se prebere direktno v svoje voxle na delovni niti
+            // shared ostane zivo (in datoteka odprta) dokler se ne nalozijo vsi chunki
+            ChunkManager::LoadChunksAsync([shared](Chunk* chunk, int x, int z) {
+                size_t offset = sizeof(SaveHeader) + (z * ChunkManager::width + x) * m_chunkDataSize;
 
-                    memcpy(chunk->GetData(), data->voxelData[z][x], Chunk::width * Chunk::width * Chunk::width);
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                TIME_FUNCTION("ReadChunk");
 
-                    chunk->GenerateMesh();
+                shared->file.seekg(offset);
+                if (!shared->file.read((char*)chunk->GetData(), m_chunkDataSize))
+                {
+                    std::cout << "failed to read chunk " << x << ", " << z << "\n";
+                    shared->file.clear();
+                    chunk->Clear();
                 }
-            }
+            });
 
-            delete data;
             std::cout << "opened world " << fileName << "\n";
         }
         else
@@ -102,32 +118,36 @@ namespace voxr::Save
 
         voxr::ChunkManager::FlushLoadQueue();
 
-        SaveData* data = new SaveData;
-        data->camPos = voxr::GetCameraPos();
-        data->camRot = voxr::GetCameraRot();
-        data->centerChunkPos = voxr::ChunkManager::GetCenterChunkPos();
-        data->seed = ChunkManager::GetSeed();
-        
-        for (int z = 0; z < ChunkManager::width; z++)
-        {
-            for (int x = 0; x < ChunkManager::width; x++)
-            {
-                memcpy(data->voxelData[z][x], ChunkManager::GetChunk(x, z)->GetData(), Chunk::width * Chunk::width * Chunk::width);
-            }
-        }
+        SaveHeader header;
+        header.camPos = voxr::GetCameraPos();
+        header.camRot = voxr::GetCameraRot();
+        header.centerChunkPos = voxr::ChunkManager::GetCenterChunkPos();
+        header.seed = ChunkManager::GetSeed();
+
+        TIME_FUNCTION("WriteWorld");
 
         std::ofstream file(fileName, std::ios::binary);
-        
+
         if (file.is_open())
         {
-            file.write((const char*)data, sizeof(SaveData));
-            std::cout << "saved world to " << fileName << "\n";
+            file.write((const char*)&header, sizeof(SaveHeader));
+
+            for (int z = 0; z < ChunkManager::width; z++)
+            {
+                for (int x = 0; x < ChunkManager::width; x++)
+                {
+                    file.write((const char*)ChunkManager::GetChunk(x, z)->GetData(), m_chunkDataSize);
+                }
+            }
+
+            if (file)
+                std::cout << "saved world to " << fileName << "\n";
+            else
+                std::cout << "failed to write world to " << fileName << "\n";
         }
         else
         {
             std::cout << "failed to save world to " << fileName << "\n";
         }
-
-        delete data;
     }
 }
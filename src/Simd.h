@@ -0,0 +1,13 @@
+#pragma once
+
+// SSE (xmmintrin, brez SSE2) za paketne zarke, frustum in occlusion culling
+// 0 = povsod skalarne poti
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define USE_SSE 1
+#else
+#define USE_SSE 0
+#endif
+
+#if USE_SSE
+#include <xmmintrin.h>
+#endif
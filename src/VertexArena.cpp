@@ -0,0 +1,299 @@
+#include "VertexArena.h"
+#include "VoxelRenderer.h"
+#include "Chunk.h"
+#include <map>
+#include <vector>
+#include <iostream>
+
+namespace voxr::VertexArena
+{
+    namespace
+    {
+        struct Pool
+        {
+            uint32_t vao = 0;
+            uint32_t vbo = 0;
+            uint32_t slotVbo = 0; // uint16 slot za vsak verteks
+            size_t vertexSize = 0;
+            size_t capacity = 0; // v verteksih
+            size_t used = 0;
+
+            std::map<uint32_t, uint32_t> freeRanges; // first -> count
+        };
+
+        Pool m_pools[(int)Stream::Count];
+
+        uint32_t m_slotPosBuffer = 0;
+        uint32_t m_slotPosTexture = 0;
+        size_t m_slotCapacity = 0;
+        std::vector<uint16_t> m_freeSlots;
+        uint16_t m_nextSlot = 1;
+
+        constexpr size_t m_initialCapacity[(int)Stream::Count] = { 4 * 1024 * 1024, 1024 * 1024 };
+        constexpr size_t m_initialSlotCapacity = 256;
+
+        // nov vecji buffer, stare podatke prekopiramo na gpu
+        uint32_t GrowBuffer(uint32_t oldBuffer, size_t oldSize, size_t newSize, GLenum usage)
+        {
+            uint32_t buffer;
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, usage);
+
+            if (oldBuffer != 0)
+            {
+                glBindBuffer(GL_COPY_READ_BUFFER, oldBuffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+                glDeleteBuffers(1, &oldBuffer);
+            }
+
+            return buffer;
+        }
+
+        void SetupVao(Stream stream)
+        {
+            Pool& pool = m_pools[(int)stream];
+            glBindVertexArray(pool.vao);
+
+            glBindBuffer(GL_ARRAY_BUFFER, pool.vbo);
+            if (stream == Stream::Color)
+            {
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
+                glEnableVertexAttribArray(1);
+                glVertexAttribIPointer(1, 1, GL_UNSIGNED_BYTE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+                glEnableVertexAttribArray(2);
+                glVertexAttribIPointer(2, 3, GL_UNSIGNED_BYTE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+            }
+            else
+            {
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+            }
+
+            glBindBuffer(GL_ARRAY_BUFFER, pool.slotVbo);
+            glEnableVertexAttribArray(3);
+            glVertexAttribIPointer(3, 1, GL_UNSIGNED_SHORT, sizeof(uint16_t), (void*)0);
+        }
+
+        void Grow(Stream stream, size_t minCapacity)
+        {
+            Pool& pool = m_pools[(int)stream];
+
+            size_t newCapacity = pool.capacity == 0 ? m_initialCapacity[(int)stream] : pool.capacity;
+            while (newCapacity < minCapacity)
+                newCapacity *= 2;
+
+            pool.vbo = GrowBuffer(pool.vbo, pool.capacity * pool.vertexSize, newCapacity * pool.vertexSize, GL_DYNAMIC_DRAW);
+            pool.slotVbo = GrowBuffer(pool.slotVbo, pool.capacity * sizeof(uint16_t), newCapacity * sizeof(uint16_t), GL_DYNAMIC_DRAW);
+
+            // nov prostor na koncu je prost, zdruzimo z zadnjim prostim delom ce se ga dotika
+            uint32_t first = (uint32_t)pool.capacity;
+            uint32_t count = (uint32_t)(newCapacity - pool.capacity);
+
+            if (pool.freeRanges.empty() == false)
+            {
+                auto last = std::prev(pool.freeRanges.end());
+                if (last->first + last->second == first)
+                {
+                    first = last->first;
+                    count += last->second;
+                    pool.freeRanges.erase(last);
+                }
+            }
+            pool.freeRanges[first] = count;
+
+            pool.capacity = newCapacity;
+
+            if (pool.vao == 0)
+                glGenVertexArrays(1, &pool.vao);
+            SetupVao(stream);
+        }
+
+        void UploadSlots(Pool& pool, const Range& range, uint16_t slot)
+        {
+            std::vector<uint16_t> slots(range.count, slot);
+            glBindBuffer(GL_ARRAY_BUFFER, pool.slotVbo);
+            glBufferSubData(GL_ARRAY_BUFFER, range.first * sizeof(uint16_t), range.count * sizeof(uint16_t), slots.data());
+        }
+
+        void GrowSlots()
+        {
+            size_t newCapacity = m_slotCapacity == 0 ? m_initialSlotCapacity : m_slotCapacity * 2;
+            m_slotPosBuffer = GrowBuffer(m_slotPosBuffer, m_slotCapacity * sizeof(glm::vec4), newCapacity * sizeof(glm::vec4), GL_DYNAMIC_DRAW);
+            m_slotCapacity = newCapacity;
+
+            glActiveTexture(GL_TEXTURE0 + slotTextureUnit);
+            glBindTexture(GL_TEXTURE_BUFFER, m_slotPosTexture);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_slotPosBuffer);
+            glActiveTexture(GL_TEXTURE0);
+        }
+    }
+
+    void Init()
+    {
+        glGenTextures(1, &m_slotPosTexture);
+        GrowSlots();
+
+        // slot 0 je brez zamika
+        glm::vec4 zero = glm::vec4(0.0f);
+        glBindBuffer(GL_TEXTURE_BUFFER, m_slotPosBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(glm::vec4), &zero);
+
+        // kar nima aSlot atributa (kocke, crte, chunki z lastnim vao) bere slot 0
+        glVertexAttribI4ui(3, 0, 0, 0, 0);
+
+        m_pools[(int)Stream::Color].vertexSize = sizeof(Vertex);
+        m_pools[(int)Stream::Depth].vertexSize = sizeof(glm::vec3);
+
+#if USE_VERTEX_ARENA
+        Grow(Stream::Color, m_initialCapacity[(int)Stream::Color]);
+        Grow(Stream::Depth, m_initialCapacity[(int)Stream::Depth]);
+#endif
+    }
+
+    Range Allocate(Stream stream, uint32_t count)
+    {
+        Pool& pool = m_pools[(int)stream];
+
+        Range range;
+        if (count == 0)
+            return range;
+
+        // first fit
+        for (int attempt = 0; attempt < 2; attempt++)
+        {
+            for (auto it = pool.freeRanges.begin(); it != pool.freeRanges.end(); it++)
+            {
+                if (it->second < count)
+                    continue;
+
+                range.first = it->first;
+                range.count = count;
+
+                uint32_t remaining = it->second - count;
+                pool.freeRanges.erase(it);
+                if (remaining > 0)
+                    pool.freeRanges[range.first + count] = remaining;
+
+                pool.used += count;
+                return range;
+            }
+
+            Grow(stream, pool.capacity + count);
+        }
+
+        std::cout << "Failed to allocate " << count << " vertices in the vertex arena!\n";
+        return Range();
+    }
+
+    void Free(Stream stream, Range& range)
+    {
+        if (range.count == 0)
+            return;
+
+        Pool& pool = m_pools[(int)stream];
+
+        uint32_t first = range.first;
+        uint32_t count = range.count;
+        pool.used -= count;
+        range = Range();
+
+        // zdruzimo s sosednjima prostima deloma
+        auto next = pool.freeRanges.lower_bound(first);
+        if (next != pool.freeRanges.end() && first + count == next->first)
+        {
+            count += next->second;
+            next = pool.freeRanges.erase(next);
+        }
+
+        if (next != pool.freeRanges.begin())
+        {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == first)
+            {
+                prev->second += count;
+                return;
+            }
+        }
+
+        pool.freeRanges[first] = count;
+    }
+
+    void Upload(const Range& range, const Vertex* vertices, uint16_t slot)
+    {
+        if (range.count == 0)
+            return;
+
+        Pool& pool = m_pools[(int)Stream::Color];
+
+        glBindBuffer(GL_ARRAY_BUFFER, pool.vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, range.first * sizeof(Vertex), range.count * sizeof(Vertex), vertices);
+
+        UploadSlots(pool, range, slot);
+    }
+
+    void Upload(const Range& range, const glm::vec3* positions, uint16_t slot)
+    {
+        if (range.count == 0)
+            return;
+
+        Pool& pool = m_pools[(int)Stream::Depth];
+
+        glBindBuffer(GL_ARRAY_BUFFER, pool.vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, range.first * sizeof(glm::vec3), range.count * sizeof(glm::vec3), positions);
+
+        UploadSlots(pool, range, slot);
+    }
+
+    uint16_t AllocateSlot(const glm::vec3& pos)
+    {
+        uint16_t slot;
+
+        if (m_freeSlots.empty() == false)
+        {
+            slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        else
+        {
+            assert(m_nextSlot != UINT16_MAX && "out of chunk slots!");
+            slot = m_nextSlot++;
+            if (slot >= m_slotCapacity)
+                GrowSlots();
+        }
+
+        SetSlotPosition(slot, pos);
+        return slot;
+    }
+
+    void SetSlotPosition(uint16_t slot, const glm::vec3& pos)
+    {
+        assert(slot != 0 && slot < m_nextSlot);
+
+        glm::vec4 data = glm::vec4(pos, 0.0f);
+        glBindBuffer(GL_TEXTURE_BUFFER, m_slotPosBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, slot * sizeof(glm::vec4), sizeof(glm::vec4), &data);
+    }
+
+    void FreeSlot(uint16_t slot)
+    {
+        if (slot != 0)
+            m_freeSlots.push_back(slot);
+    }
+
+    uint32_t GetVao(Stream stream)
+    {
+        return m_pools[(int)stream].vao;
+    }
+
+    size_t GetCapacity(Stream stream)
+    {
+        return m_pools[(int)stream].capacity;
+    }
+
+    size_t GetUsedVertices(Stream stream)
+    {
+        return m_pools[(int)stream].used;
+    }
+}
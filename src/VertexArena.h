@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace voxr
+{
+    struct Vertex;
+}
+
+namespace voxr::VertexArena
+{
+    // del skupnega vertex bufferja, ki pripada enemu meshu
+    struct Range
+    {
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    // Color = poln mesh (Vertex), Depth = samo pozicije za shadow pass
+    enum class Stream
+    {
+        Color,
+        Depth,
+        Count
+    };
+
+    void Init();
+
+    // vsi chunk meshi enega streama so v enem velikem bufferju z enim vao-jem
+    // ce zmanjka prostora, se buffer poveca (obstojeci range-i ostanejo veljavni)
+    Range Allocate(Stream stream, uint32_t count);
+    void Free(Stream stream, Range& range);
+    void Upload(const Range& range, const Vertex* vertices, uint16_t slot);
+    void Upload(const Range& range, const glm::vec3* positions, uint16_t slot);
+
+    // slot je indeks v tabeli pozicij chunkov (aSlot v shaderju)
+    // slot 0 je rezerviran in ima pozicijo 0, 0, 0 (za vse kar ni v areni)
+    uint16_t AllocateSlot(const glm::vec3& pos);
+    void FreeSlot(uint16_t slot);
+    // premik chunka: vertexi obdrzijo slot, spremeni se samo pozicija v tabeli
+    void SetSlotPosition(uint16_t slot, const glm::vec3& pos);
+
+    uint32_t GetVao(Stream stream = Stream::Color);
+    size_t GetCapacity(Stream stream = Stream::Color);
+    size_t GetUsedVertices(Stream stream = Stream::Color);
+
+    // texture unit za uChunkPositions
+    inline constexpr int slotTextureUnit = 1;
+}
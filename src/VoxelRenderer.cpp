@@ -6,12 +6,19 @@
 #include "ChunkManager.h"
 #include "Save.h"
 #include "Physics.h"
+#include "Collision.h"
 #include "Editing.h"
+#include "Journal.h"
+#include "VertexArena.h"
+#include "Occlusion.h"
+#include "FarTerrain.h"
+#include "FuncTimer.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <stdarg.h>
 #include <limits>
+#include <cstddef>
 
 // anonymous namespace
 namespace
@@ -20,8 +27,33 @@ namespace
     glm::ivec2 m_windowSize;
 
     uint32_t m_shaderProgram;
+    int m_modelLoc; // vec4: xyz = zamik, w = skala
+    uint32_t m_farTerrainProgram;
     uint32_t m_cubeVao;
 
+    // cascaded shadow maps, vsi cascadi so en poleg drugega v enem atlasu
+    constexpr int m_numCascades = 3; // isto kot NUM_CASCADES v shaderjih
+    constexpr float m_cascadeSplits[m_numCascades] = { 3.0f, 8.0f, 20.0f }; // zadnji je meja senc, SHADOW_DISTANCE v frag.glsl
+    constexpr int m_cascadeResolutions[m_numCascades] = { 2048, 2048, 1024 };
+    constexpr GLenum m_shadowDepthFormat = GL_DEPTH_COMPONENT24; // ali GL_DEPTH_COMPONENT16
+    constexpr float m_shadowCasterDistance = 20.0f; // kako dalec proti luci se iscejo sence
+    constexpr float m_cascadeMargin = 0.2f; // delez radija, za katerega se lahko kamera premakne brez ponovnega risanja
+
+    // std140, mora se ujemati z blokom FrameData v shaderjih
+    struct FrameData
+    {
+        glm::mat4 viewProj;
+        glm::mat4 shadowViewProj[m_numCascades];
+        glm::vec4 shadowAtlasRects[m_numCascades]; // xy = zamik, zw = velikost (v uv atlasa)
+        glm::vec3 cameraPos;
+        float fogEnd;
+    };
+
+    uint32_t m_frameUbo;
+    bool m_frameDataDirty = true;
+    constexpr float m_fogEnd = 20.0f; // brez FarTerrain, malo pred robom mreze chunkov
+    constexpr int m_frameDataBinding = 0;
+
     glm::vec3 m_camPos = { 0.0f, 0.5f, 2.0f };
     glm::vec2 m_camRot = {};
     glm::vec3 m_camForward = {};
@@ -42,8 +74,35 @@ namespace
     uint32_t m_shadowFbo;
     uint32_t m_shadowTexture;
     uint32_t m_shadowShaderProgram;
-    glm::mat4 m_shadowViewProj;
-    constexpr int m_shadowMapSize = 8192;
+    int m_shadowModelLoc;
+    int m_shadowCascadeLoc;
+
+    // shadow map se ne rise vsak frame, ampak samo ko se cascade premakne ali se spremeni geometrija
+    struct ShadowCascade
+    {
+        glm::mat4 viewProj;
+        glm::vec3 center;
+        float radius = 0.0f; // z robom
+        bool valid = false;
+
+        bool hasDirtyRegion = false;
+        glm::vec3 dirtyMin;
+        glm::vec3 dirtyMax;
+    };
+
+    ShadowCascade m_cascades[m_numCascades];
+    uint32_t m_shadowFrame = 0;
+    voxr::ShadowStats m_shadowStats;
+
+    bool m_depthPrepass = false;
+    voxr::RenderStats m_renderStats;
+
+    // GL_SAMPLES_PASSED, rezultat preberemo z zamikom dveh frameov, da ne cakamo na gpu
+    uint32_t m_fragmentQueries[2];
+    bool m_fragmentQueryIssued[2] = {};
+    int m_fragmentQueryIndex = 0;
+    glm::ivec4 m_shadowAtlasRects[m_numCascades]; // v texlih
+    glm::ivec2 m_shadowAtlasSize;
 
     constexpr float m_moveSpeed = 2.0f;
     constexpr float m_sprintSpeedMult = 2.5f;
@@ -60,18 +119,250 @@ namespace
         glViewport(0, 0, width, height);
     }
 
+    // vidne sekcije chunka brez smeri ploskev, ki so obrnjene stran od kamere
+    // zaporedni deli mesha se zdruzijo v en draw
+    void AddChunkDraws(const voxr::Chunk& chunk, GLint base, std::vector<GLint>& firsts, std::vector<GLsizei>& counts)
+    {
+        // manjsi lod-i so dalec in majhni, zato se risejo celi
+        if (chunk.GetLod() > 0)
+        {
+            const voxr::VertexArena::Range& range = chunk.GetLodRange(chunk.GetLod());
+            if (range.count != 0)
+            {
+                firsts.push_back(base + (GLint)range.first);
+                counts.push_back((GLsizei)range.count);
+            }
+            return;
+        }
+
+        uint8_t visible = chunk.GetVisibleSections();
+
+        for (int section = voxr::Chunk::numSections - 1; section >= 0; section--)
+        {
+            glm::vec3 min, max;
+            if ((visible & (1 << section)) == 0 || !chunk.GetSectionBounds(section, &min, &max))
+                continue;
+
+            // ploskve smeri +x so na ravninah x > min.x, ce je kamera levo od vseh, jih ne vidimo
+            bool backFacing[6];
+            backFacing[0] = m_camPos.x >= max.x;
+            backFacing[1] = m_camPos.x <= min.x;
+            backFacing[2] = m_camPos.y >= max.y;
+            backFacing[3] = m_camPos.y <= min.y;
+            backFacing[4] = m_camPos.z >= max.z;
+            backFacing[5] = m_camPos.z <= min.z;
+
+            for (int face = 0; face < 6; face++)
+            {
+                const voxr::VertexArena::Range& range = chunk.GetFaceRange(section, face);
+                if (backFacing[face] || range.count == 0)
+                    continue;
+
+                GLint first = base + (GLint)range.first;
+
+                if (firsts.empty() == false && firsts.back() + counts.back() == first)
+                {
+                    counts.back() += (GLsizei)range.count;
+                }
+                else
+                {
+                    firsts.push_back(first);
+                    counts.push_back((GLsizei)range.count);
+                }
+            }
+        }
+    }
+
     void CalcViewProjMat()
     {
         glm::mat4 view = glm::lookAt(m_camPos, m_camPos + m_camForward, glm::vec3(0, 1, 0));
-        glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)m_windowSize.x / m_windowSize.y, 0.01f, 100.0f);
+        // far plane mora doseci vogale FarTerrain
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)m_windowSize.x / m_windowSize.y, 0.01f, 300.0f);
 
         m_viewProj = projection * view;
+        m_frameDataDirty = true;
 
         glm::mat4 oview = glm::lookAt(glm::vec3(0, 50, 0), glm::vec3(0, 0, -0.1f), glm::vec3(0, 1, 0));
         //glm::mat4 oview = glm::lookAt(glm::vec3(2, 0, 0), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
         m_otherViewProj = projection * oview;
     }
 
+    // enkrat na frame (oz. ko se kamera ali senca spremenita), ne za vsak draw
+    void UploadFrameData()
+    {
+        if (m_frameDataDirty == false)
+            return;
+
+        FrameData data;
+        data.viewProj = m_viewProj;
+        for (int i = 0; i < m_numCascades; i++)
+        {
+            data.shadowViewProj[i] = m_cascades[i].viewProj;
+            glm::vec2 atlasSize = glm::vec2(m_shadowAtlasSize);
+            data.shadowAtlasRects[i] = glm::vec4(m_shadowAtlasRects[i]) / glm::vec4(atlasSize.x, atlasSize.y, atlasSize.x, atlasSize.y);
+        }
+        data.cameraPos = m_camPos;
+        // z visinskim poljem megla skrije samo njegov zunanji rob
+        data.fogEnd = voxr::FarTerrain::IsEnabled() ? voxr::FarTerrain::GetRadius() * 0.95f : m_fogEnd;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, m_frameUbo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+
+        m_frameDataDirty = false;
+    }
+
+    // krogla, ki objame del frustuma kamere za ta cascade
+    void CalcCascadeSphere(int cascade, glm::vec3* outCenter, float* outRadius)
+    {
+        const std::array<glm::vec3, 8>& camCorners = voxr::GetCamFrustumCorners();
+
+        float nearDist = cascade == 0 ? 0.0f : m_cascadeSplits[cascade - 1];
+        float farDist = m_cascadeSplits[cascade];
+
+        std::array<glm::vec3, 8> corners;
+        for (int i = 0; i < 4; i++)
+        {
+            const glm::vec3& near = camCorners[i];
+            const glm::vec3& far = camCorners[i + 4];
+            glm::vec3 dir = glm::normalize(far - near);
+
+            corners[i] = near + dir * nearDist;
+            corners[i + 4] = near + dir * farDist;
+        }
+
+        glm::vec3 center = {};
+        for (const auto& c : corners)
+            center += c;
+        center /= (float)corners.size();
+
+        float radius = 0.0f;
+        for (const auto& c : corners)
+            radius = glm::max(radius, glm::length(c - center));
+
+        *outCenter = center;
+        *outRadius = radius;
+    }
+
+    // ortho projekcija okoli krogle, poravnana na texle, da se sence ne tresejo
+    glm::mat4 CalcCascadeViewProj(int cascade, const glm::vec3& center, float radius)
+    {
+        constexpr glm::vec3 lightDir = glm::vec3(0.5f, -1.5f, -0.7f); // isto kot v shaderju
+        glm::vec3 dir = glm::normalize(lightDir);
+
+        glm::mat4 view = glm::lookAt(center - dir * m_shadowCasterDistance, center, glm::vec3(0, 1, 0));
+        glm::mat4 proj = glm::ortho(-radius, radius, -radius, radius, 0.1f, m_shadowCasterDistance + radius);
+
+        // izhodisce sveta premaknemo na cel texel
+        float halfRes = m_cascadeResolutions[cascade] / 2.0f;
+        glm::vec4 origin = proj * view * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        glm::vec2 texelOrigin = glm::vec2(origin.x, origin.y) * halfRes;
+        glm::vec2 offset = (glm::round(texelOrigin) - texelOrigin) / halfRes;
+        proj[3][0] += offset.x;
+        proj[3][1] += offset.y;
+
+        return proj * view;
+    }
+
+    // aabb v ndc shadow mapa, ki objame aabb v svetu
+    void ProjectToShadowSpace(const glm::mat4& viewProj, const glm::vec3& min, const glm::vec3& max, glm::vec3* outMin, glm::vec3* outMax)
+    {
+        *outMin = glm::vec3(std::numeric_limits<float>::max());
+        *outMax = glm::vec3(std::numeric_limits<float>::lowest());
+
+        for (int i = 0; i < 8; i++)
+        {
+            glm::vec3 corner = glm::vec3(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+            glm::vec3 p = glm::vec3(viewProj * glm::vec4(corner, 1.0f));
+
+            *outMin = glm::min(*outMin, p);
+            *outMax = glm::max(*outMax, p);
+        }
+    }
+
+    void DrawShadowCasters(int cascade, const glm::vec4& region)
+    {
+        const glm::mat4& viewProj = m_cascades[cascade].viewProj;
+
+#if USE_VERTEX_ARENA
+        static std::vector<GLint> firsts;
+        static std::vector<GLsizei> counts;
+        firsts.clear();
+        counts.clear();
+#endif
+
+        for (int z = 0; z < voxr::ChunkManager::width; z++)
+        {
+            for (int x = 0; x < voxr::ChunkManager::width; x++)
+            {
+                voxr::Chunk* chunk = voxr::ChunkManager::GetChunk(x, z);
+                if (chunk->GetNumDepthVertices() == 0)
+                    continue;
+
+                glm::vec3 boundsMin, boundsMax;
+                chunk->GetBounds(&boundsMin, &boundsMax);
+
+                glm::vec3 min, max;
+                ProjectToShadowSpace(viewProj, boundsMin, boundsMax, &min, &max);
+
+                // pred near planom ne izlocamo (depth clamp), to so sence od dalec proti luci,
+                // za far planom pa ni nicesar, na kar bi lahko metale senco
+                if (max.x < region.x || min.x > region.z || max.y < region.y || min.y > region.w || min.z > 1.0f)
+                {
+                    m_shadowStats.culled++;
+                    continue;
+                }
+
+                m_shadowStats.casters++;
+
+#if USE_VERTEX_ARENA
+                firsts.push_back(chunk->GetDepthArenaRange().first);
+                counts.push_back((GLsizei)chunk->GetNumDepthVertices());
+#else
+                const glm::vec3& pos = chunk->GetPosition();
+                glUniform4f(m_shadowModelLoc, pos.x, pos.y, pos.z, 1.0f);
+
+                glBindVertexArray(chunk->GetDepthVao());
+                glDrawArrays(GL_TRIANGLES, 0, chunk->GetNumDepthVertices());
+#endif
+            }
+        }
+
+#if USE_VERTEX_ARENA
+        if (firsts.empty() == false)
+        {
+            glUniform4f(m_shadowModelLoc, 0.0f, 0.0f, 0.0f, 1.0f);
+            glBindVertexArray(voxr::VertexArena::GetVao(voxr::VertexArena::Stream::Depth));
+            glMultiDrawArrays(GL_TRIANGLES, firsts.data(), counts.data(), (GLsizei)firsts.size());
+        }
+#endif
+    }
+
+    void ReadFragmentQuery()
+    {
+        uint32_t query = m_fragmentQueries[m_fragmentQueryIndex];
+        if (m_fragmentQueryIssued[m_fragmentQueryIndex] == false)
+            return;
+
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0)
+            return;
+
+        GLuint64 samples = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &samples);
+
+        m_renderStats.fragments = samples;
+        m_renderStats.overdraw = (float)samples / ((float)m_windowSize.x * m_windowSize.y);
+    }
+
+#if USE_DEBUG_CAMERA
+    void SetFrameViewProj(const glm::mat4& viewProj)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_frameUbo);
+        glBufferSubData(GL_UNIFORM_BUFFER, offsetof(FrameData, viewProj), sizeof(glm::mat4), &viewProj[0][0]);
+    }
+#endif
+
     void OnGlfwKey(GLFWwindow* window, int key, int scancode, int action, int mods)
     {
         if (action != GLFW_PRESS) return;
@@ -118,9 +409,73 @@ namespace
             }
             break;
 
+        case GLFW_KEY_Z:
+            if (mods & GLFW_MOD_CONTROL)
+            {
+                if (mods & GLFW_MOD_SHIFT)
+                    voxr::Journal::Redo();
+                else
+                    voxr::Journal::Undo();
+            }
+            break;
+
+        case GLFW_KEY_Y:
+            if (mods & GLFW_MOD_CONTROL)
+                voxr::Journal::Redo();
+            break;
+
         case GLFW_KEY_G:
             voxr::Physics::SetUseGravity(!voxr::Physics::GetUseGravity());
             break;
+
+        case GLFW_KEY_P:
+            m_depthPrepass = !m_depthPrepass;
+            break;
+
+        case GLFW_KEY_C:
+            voxr::Occlusion::SetEnabled(!voxr::Occlusion::IsEnabled());
+            break;
+
+        case GLFW_KEY_V:
+            voxr::ChunkManager::SetSectionCulling(!voxr::ChunkManager::GetSectionCulling());
+            break;
+
+        case GLFW_KEY_L:
+            voxr::ChunkManager::SetLodEnabled(!voxr::ChunkManager::GetLodEnabled());
+            break;
+
+        case GLFW_KEY_H:
+            voxr::FarTerrain::SetEnabled(!voxr::FarTerrain::IsEnabled());
+            m_frameDataDirty = true; // megla
+            break;
+
+        case GLFW_KEY_T:
+            voxr::Profiler::SetOverlay(!voxr::Profiler::GetOverlay());
+            break;
+
+        case GLFW_KEY_F9:
+            voxr::Profiler::StartCapture(voxr::Profiler::defaultCaptureFrames);
+            break;
+
+        case GLFW_KEY_1:
+        case GLFW_KEY_2:
+        case GLFW_KEY_3:
+        {
+            voxr::Brush brush = voxr::GetBrush();
+            brush.shape = (voxr::BrushShape)(key - GLFW_KEY_1);
+            voxr::SetBrush(brush);
+            break;
+        }
+
+        case GLFW_KEY_LEFT_BRACKET:
+        case GLFW_KEY_RIGHT_BRACKET:
+        {
+            voxr::Brush brush = voxr::GetBrush();
+            brush.radius += (key == GLFW_KEY_RIGHT_BRACKET) ? 1 : -1;
+            brush.radius = glm::clamp(brush.radius, 0, 32);
+            voxr::SetBrush(brush);
+            break;
+        }
         }
     }
 
@@ -171,8 +526,19 @@ namespace voxr
 
         std::cout << glGetString(GL_VERSION) << "\n";
 
+        glGenBuffers(1, &m_frameUbo);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_frameUbo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, m_frameDataBinding, m_frameUbo);
+
         m_shaderProgram = LoadShaderProgram("res/vert.glsl", "res/frag.glsl");
+        m_modelLoc = glGetUniformLocation(m_shaderProgram, "uModel");
         m_shadowShaderProgram = LoadShaderProgram("res/shadowVert.glsl", "res/shadowFrag.glsl");
+        m_shadowModelLoc = glGetUniformLocation(m_shadowShaderProgram, "uModel");
+        m_shadowCascadeLoc = glGetUniformLocation(m_shadowShaderProgram, "uCascade");
+        m_farTerrainProgram = LoadShaderProgram("res/farVert.glsl", "res/frag.glsl");
+
+        VertexArena::Init();
 
         gltInit();
 
@@ -264,13 +630,22 @@ namespace voxr
         glGenFramebuffers(1, &m_shadowFbo);
         glBindFramebuffer(GL_FRAMEBUFFER, m_shadowFbo);
 
+        m_shadowAtlasSize = glm::ivec2(0);
+        for (int i = 0; i < m_numCascades; i++)
+        {
+            int res = m_cascadeResolutions[i];
+            m_shadowAtlasRects[i] = glm::ivec4(m_shadowAtlasSize.x, 0, res, res);
+            m_shadowAtlasSize.x += res;
+            m_shadowAtlasSize.y = glm::max(m_shadowAtlasSize.y, res);
+        }
+
         glGenTextures(1, &m_shadowTexture);
         glBindTexture(GL_TEXTURE_2D, m_shadowTexture);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, m_shadowMapSize, m_shadowMapSize, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        glTexImage2D(GL_TEXTURE_2D, 0, m_shadowDepthFormat, m_shadowAtlasSize.x, m_shadowAtlasSize.y, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
 
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_shadowTexture, 0);
         glDrawBuffer(GL_NONE); // oboje na none ker ta framebuffer ne bo imel barv
@@ -283,6 +658,10 @@ namespace voxr
 
         //
 
+        glGenQueries(2, m_fragmentQueries);
+
+        //
+
         glEnable(GL_CULL_FACE);
         glEnable(GL_DEPTH_TEST);
     }
@@ -294,6 +673,8 @@ namespace voxr
 
     void UpdateCamera(float deltaTime)
     {
+        TIME_FUNCTION("UpdateCamera");
+
         glm::mat4 rotMat(1.0f);
         rotMat = glm::rotate(rotMat, m_camRot.x, glm::vec3(0, -1, 0));
         rotMat = glm::rotate(rotMat, m_camRot.y, glm::vec3(-1, 0, 0));
@@ -325,19 +706,27 @@ namespace voxr
             moveRight *= m_walkSpeedMult;
         }
 
+        glm::vec3 move = glm::vec3(0.0f);
+
         if (glfwGetKey(m_window, GLFW_KEY_W))
-            m_camPos += moveForward * m_moveSpeed * deltaTime;
+            move += moveForward * m_moveSpeed * deltaTime;
         if (glfwGetKey(m_window, GLFW_KEY_S))
-            m_camPos -= moveForward * m_moveSpeed * deltaTime;
+            move -= moveForward * m_moveSpeed * deltaTime;
         if (glfwGetKey(m_window, GLFW_KEY_D))
-            m_camPos += moveRight * m_moveSpeed * deltaTime;
+            move += moveRight * m_moveSpeed * deltaTime;
         if (glfwGetKey(m_window, GLFW_KEY_A))
-            m_camPos -= moveRight * m_moveSpeed * deltaTime;
+            move -= moveRight * m_moveSpeed * deltaTime;
 
         if (glfwGetKey(m_window, GLFW_KEY_E))
-            m_camPos.y += m_moveSpeed * deltaTime;
+            move.y += m_moveSpeed * deltaTime;
         if (glfwGetKey(m_window, GLFW_KEY_Q))
-            m_camPos.y -= m_moveSpeed * deltaTime;
+            move.y -= m_moveSpeed * deltaTime;
+
+        // ko hodimo se zaletimo v voxle, ko letimo pa ne
+        if (Physics::GetUseGravity())
+            m_camPos = Collision::MovePlayer(m_camPos, move);
+        else
+            m_camPos += move;
 
         if (m_mouseEnabled)
         {
@@ -354,7 +743,9 @@ namespace voxr
 
         CalcViewProjMat();
 
-        UpdateCameraFrustum(m_camPos, m_camForward, m_camRight, 0.01f, 25.0f, (float)m_windowSize.x / m_windowSize.y);
+        // brez megle (FarTerrain) morajo biti vidni vsi chunki do vogala mreze
+        float cullDistance = FarTerrain::IsEnabled() ? ChunkManager::width * Chunk::worldWidth : 25.0f;
+        UpdateCameraFrustum(m_camPos, m_camForward, m_camRight, 0.01f, cullDistance, (float)m_windowSize.x / m_windowSize.y);
     }
 
     const glm::vec3& GetCameraPos()
@@ -365,6 +756,7 @@ namespace voxr
     void SetCameraPos(const glm::vec3& pos)
     {
         m_camPos = pos;
+        m_frameDataDirty = true;
     }
 
     const glm::vec3& GetCameraForward()
@@ -387,29 +779,20 @@ namespace voxr
 #if USE_DEBUG_CAMERA
         glViewport(m_windowSize.x / 3, m_windowSize.y / 3, m_windowSize.x * 2 / 3, m_windowSize.y * 2 / 3);
 #endif
-        glm::mat4 model(1.0f);
-        model = glm::translate(model, pos);
-        model = glm::scale(model, glm::vec3(1.0f / 16.0f));
-
-        glm::mat3 normalMat = glm::mat3(glm::transpose(glm::inverse(model)));
+        UploadFrameData();
 
         glUseProgram(m_shaderProgram);
-
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uModel"), 1, GL_FALSE, &model[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uViewProj"), 1, GL_FALSE, &m_viewProj[0][0]);
-        glUniformMatrix3fv(glGetUniformLocation(m_shaderProgram, "uNormalMat"), 1, GL_FALSE, &normalMat[0][0]);
-        glUniform3fv(glGetUniformLocation(m_shaderProgram, "uCameraPos"), 1, &m_camPos[0]);
+        glUniform4f(m_modelLoc, pos.x, pos.y, pos.z, 1.0f / 16.0f);
         glBindTexture(GL_TEXTURE_2D, m_shadowTexture);
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uShadowViewProj"), 1, GL_FALSE, &m_shadowViewProj[0][0]);
 
         glBindVertexArray(m_cubeVao);
         glDrawArrays(GL_TRIANGLES, 0, 36);
 
 #if USE_DEBUG_CAMERA
         glViewport(0, 0, m_windowSize.x / 3, m_windowSize.y / 3);
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uViewProj"), 1, GL_FALSE, &m_otherViewProj[0][0]);
+        SetFrameViewProj(m_otherViewProj);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-
+        SetFrameViewProj(m_viewProj);
 
         glViewport(0, 0, m_windowSize.x, m_windowSize.y);
 #endif
@@ -442,36 +825,230 @@ namespace voxr
         DrawText(buf, pos);
     }
 
-    void DrawChunk(const Chunk& chunk, const glm::vec3& pos)
+    void DrawChunk(const Chunk& chunk, [[maybe_unused]] const glm::vec3& pos)
     {
+        if (chunk.GetNumVertices() == 0)
+            return;
+
 #if USE_DEBUG_CAMERA
         glViewport(m_windowSize.x / 3, m_windowSize.y / 3, m_windowSize.x * 2 / 3, m_windowSize.y * 2 / 3);
 #endif
 
-        glm::mat4 model(1.0f);
-        model = glm::translate(model, pos);
-
-        glm::mat3 normalMat = glm::mat3(glm::transpose(glm::inverse(model)));
+        UploadFrameData();
 
         glUseProgram(m_shaderProgram);
-
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uModel"), 1, GL_FALSE, &model[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uViewProj"), 1, GL_FALSE, &m_viewProj[0][0]);
-        glUniformMatrix3fv(glGetUniformLocation(m_shaderProgram, "uNormalMat"), 1, GL_FALSE, &normalMat[0][0]);
-        glUniform3fv(glGetUniformLocation(m_shaderProgram, "uCameraPos"), 1, &m_camPos[0]);
         glBindTexture(GL_TEXTURE_2D, m_shadowTexture);
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uShadowViewProj"), 1, GL_FALSE, &m_shadowViewProj[0][0]);
 
+#if USE_VERTEX_ARENA
+        // z areno je pozicija chunka ze v uChunkPositions
+        glUniform4f(m_modelLoc, 0.0f, 0.0f, 0.0f, 1.0f);
+        glBindVertexArray(VertexArena::GetVao());
+        GLint first = chunk.GetArenaRange().first;
+#else
+        glUniform4f(m_modelLoc, pos.x, pos.y, pos.z, 1.0f);
         glBindVertexArray(chunk.GetVao());
-        glDrawArrays(GL_TRIANGLES, 0, chunk.GetNumVertices());
+        GLint first = 0;
+#endif
+        static std::vector<GLint> firsts;
+        static std::vector<GLsizei> counts;
+        firsts.clear();
+        counts.clear();
+        AddChunkDraws(chunk, first, firsts, counts);
+
+        glMultiDrawArrays(GL_TRIANGLES, firsts.data(), counts.data(), (GLsizei)firsts.size());
 
 #if USE_DEBUG_CAMERA
         glViewport(0, 0, m_windowSize.x / 3, m_windowSize.y / 3);
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uViewProj"), 1, GL_FALSE, &m_otherViewProj[0][0]);
-        glDrawArrays(GL_TRIANGLES, 0, chunk.GetNumVertices());
+        SetFrameViewProj(m_otherViewProj);
+        glMultiDrawArrays(GL_TRIANGLES, firsts.data(), counts.data(), (GLsizei)firsts.size());
+        SetFrameViewProj(m_viewProj);
+
+        glViewport(0, 0, m_windowSize.x, m_windowSize.y);
+#endif
+    }
+
+    // samo globina, z depth meshi in shadow programom, da glavni pass vsak piksel pobarva samo enkrat
+    void DepthPrepass(const std::vector<const Chunk*>& chunks)
+    {
+        UploadFrameData();
+
+        glUseProgram(m_shadowShaderProgram);
+        glUniform1i(m_shadowCascadeLoc, -1);
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+        // depth meshi so drugace triangulirani kot barvni, zato prepass malo odmaknemo
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(1.0f, 1.0f);
+
+#if USE_DEBUG_CAMERA
+        glViewport(m_windowSize.x / 3, m_windowSize.y / 3, m_windowSize.x * 2 / 3, m_windowSize.y * 2 / 3);
+#endif
+
+#if USE_VERTEX_ARENA
+        static std::vector<GLint> firsts;
+        static std::vector<GLsizei> counts;
+        firsts.clear();
+        counts.clear();
+
+        for (const Chunk* chunk : chunks)
+        {
+            if (chunk->GetNumDepthVertices() == 0)
+                continue;
+
+            firsts.push_back(chunk->GetDepthArenaRange().first);
+            counts.push_back((GLsizei)chunk->GetNumDepthVertices());
+        }
+
+        if (firsts.empty() == false)
+        {
+            glUniform4f(m_shadowModelLoc, 0.0f, 0.0f, 0.0f, 1.0f);
+            glBindVertexArray(VertexArena::GetVao(VertexArena::Stream::Depth));
+            glMultiDrawArrays(GL_TRIANGLES, firsts.data(), counts.data(), (GLsizei)firsts.size());
+        }
+#else
+        for (const Chunk* chunk : chunks)
+        {
+            if (chunk->GetNumDepthVertices() == 0)
+                continue;
+
+            const glm::vec3& pos = chunk->GetPosition();
+            glUniform4f(m_shadowModelLoc, pos.x, pos.y, pos.z, 1.0f);
+
+            glBindVertexArray(chunk->GetDepthVao());
+            glDrawArrays(GL_TRIANGLES, 0, chunk->GetNumDepthVertices());
+        }
+#endif
 
+#if USE_DEBUG_CAMERA
         glViewport(0, 0, m_windowSize.x, m_windowSize.y);
 #endif
+
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    // barvni pass za seznam chunkov, ki so ze urejeni od spredaj nazaj
+    void DrawChunkList(const std::vector<const Chunk*>& chunks)
+    {
+#if USE_VERTEX_ARENA
+        static std::vector<GLint> firsts;
+        static std::vector<GLsizei> counts;
+        firsts.clear();
+        counts.clear();
+
+        for (const Chunk* chunk : chunks)
+        {
+            if (chunk->GetNumVertices() == 0)
+                continue;
+
+            AddChunkDraws(*chunk, chunk->GetArenaRange().first, firsts, counts);
+        }
+
+        if (firsts.empty() == false)
+        {
+#if USE_DEBUG_CAMERA
+            glViewport(m_windowSize.x / 3, m_windowSize.y / 3, m_windowSize.x * 2 / 3, m_windowSize.y * 2 / 3);
+#endif
+
+            UploadFrameData();
+
+            glUseProgram(m_shaderProgram);
+            glUniform4f(m_modelLoc, 0.0f, 0.0f, 0.0f, 1.0f);
+            glBindTexture(GL_TEXTURE_2D, m_shadowTexture);
+
+            glBindVertexArray(VertexArena::GetVao());
+            glMultiDrawArrays(GL_TRIANGLES, firsts.data(), counts.data(), (GLsizei)firsts.size());
+
+#if USE_DEBUG_CAMERA
+            glViewport(0, 0, m_windowSize.x / 3, m_windowSize.y / 3);
+            SetFrameViewProj(m_otherViewProj);
+            glMultiDrawArrays(GL_TRIANGLES, firsts.data(), counts.data(), (GLsizei)firsts.size());
+            SetFrameViewProj(m_viewProj);
+
+            glViewport(0, 0, m_windowSize.x, m_windowSize.y);
+#endif
+        }
+#else
+        for (const Chunk* chunk : chunks)
+            DrawChunk(*chunk, chunk->GetPosition());
+#endif
+    }
+
+    void DrawChunks(const std::vector<const Chunk*>& chunks)
+    {
+        m_renderStats.visibleChunks = (int)chunks.size();
+        m_renderStats.depthPrepass = m_depthPrepass;
+        ReadFragmentQuery();
+
+        // LOD meshi se ne ujemajo z depth meshi polne locljivosti, zato gredo mimo prepassa
+        // in jih narisemo za ostalimi z normalnim depth testom (in izven stetja overdrawa)
+        static std::vector<const Chunk*> fullChunks;
+        static std::vector<const Chunk*> lodChunks;
+        fullChunks.clear();
+        lodChunks.clear();
+
+        for (const Chunk* chunk : chunks)
+            (chunk->GetLod() > 0 ? lodChunks : fullChunks).push_back(chunk);
+
+        if (m_depthPrepass)
+        {
+            DepthPrepass(fullChunks);
+
+            // globina je ze zapisana, barvamo samo najblizje ploskve
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_FALSE);
+        }
+
+        glBeginQuery(GL_SAMPLES_PASSED, m_fragmentQueries[m_fragmentQueryIndex]);
+
+        DrawChunkList(fullChunks);
+
+        glEndQuery(GL_SAMPLES_PASSED);
+        m_fragmentQueryIssued[m_fragmentQueryIndex] = true;
+        m_fragmentQueryIndex = (m_fragmentQueryIndex + 1) % 2;
+
+        if (m_depthPrepass)
+        {
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+        }
+
+        DrawChunkList(lodChunks);
+    }
+
+    void DrawFarTerrain()
+    {
+        if (FarTerrain::GetNumIndices() == 0)
+            return;
+
+        UploadFrameData();
+
+        glUseProgram(m_farTerrainProgram);
+        glBindTexture(GL_TEXTURE_2D, m_shadowTexture);
+
+        glBindVertexArray(FarTerrain::GetVao());
+        glDrawElements(GL_TRIANGLES, FarTerrain::GetNumIndices(), GL_UNSIGNED_INT, nullptr);
+    }
+
+    void SetDepthPrepass(bool enabled)
+    {
+        m_depthPrepass = enabled;
+    }
+
+    bool GetDepthPrepass()
+    {
+        return m_depthPrepass;
+    }
+
+    const RenderStats& GetRenderStats()
+    {
+        return m_renderStats;
+    }
+
+    const glm::mat4& GetViewProj()
+    {
+        return m_viewProj;
     }
 
     void DrawLine(const glm::vec3& a, const glm::vec3& b)
@@ -493,12 +1070,10 @@ namespace voxr
         glBindBuffer(GL_ARRAY_BUFFER, m_lineVbo);
         glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * m_lineDrawIndex, m_lineDrawBuffer);
 
-        glm::mat4 model(1.0f);
+        UploadFrameData();
 
         glUseProgram(m_shaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uModel"), 1, GL_FALSE, &model[0][0]);
-        glUniform3fv(glGetUniformLocation(m_shaderProgram, "uCameraPos"), 1, &m_camPos[0]);
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uViewProj"), 1, GL_FALSE, &m_viewProj[0][0]);
+        glUniform4f(m_modelLoc, 0.0f, 0.0f, 0.0f, 1.0f);
 
 #if USE_DEBUG_CAMERA
         glViewport(m_windowSize.x / 3, m_windowSize.y / 3, m_windowSize.x * 2 / 3, m_windowSize.y * 2 / 3);
@@ -508,8 +1083,9 @@ namespace voxr
 
 #if USE_DEBUG_CAMERA
         glViewport(0, 0, m_windowSize.x / 3, m_windowSize.y / 3);
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uViewProj"), 1, GL_FALSE, &m_otherViewProj[0][0]);
+        SetFrameViewProj(m_otherViewProj);
         glDrawArrays(GL_LINES, 0, m_lineDrawIndex);
+        SetFrameViewProj(m_viewProj);
 
         glViewport(0, 0, m_windowSize.x, m_windowSize.y);
 #endif
@@ -519,98 +1095,127 @@ namespace voxr
 
     void ShadowPass()
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, m_shadowFbo);
-        glViewport(0, 0, m_shadowMapSize, m_shadowMapSize);
-        glClear(GL_DEPTH_BUFFER_BIT);
+        TIME_FUNCTION("ShadowPass");
 
         // https://learnopengl.com/Guest-Articles/2021/CSM
 
-        std::array<glm::vec3, 8> frustumCorners = voxr::GetCamFrustumCorners();
+        m_shadowFrame++;
+        m_shadowStats = {};
 
-        for (int i = 4; i < 8; i++)
-        {
-            const glm::vec3& near = frustumCorners[i - 4];
-            const glm::vec3& far = frustumCorners[i];
-            
-            constexpr float shadowDistance = 6.0f;
+        bool redraw[m_numCascades] = {};
+        glm::vec4 regions[m_numCascades];
 
-            frustumCorners[i] = glm::normalize(far - near) * shadowDistance + near;
-        }
+        for (int i = 0; i < m_numCascades; i++)
+        {
+            ShadowCascade& cascade = m_cascades[i];
 
-        glm::vec3 frustumCenter = {};
-        for (const auto& p : frustumCorners)
-            frustumCenter += p;
-        frustumCenter /= (float)frustumCorners.size();
-        frustumCenter.y = 0.0f;
+            // prvi cascade se lahko posodobi vsak frame, ostali izmenicno
+            if (cascade.valid && i != 0 && m_shadowFrame % 2 != (uint32_t)i % 2)
+                continue;
 
-        constexpr glm::vec3 lightDir = glm::vec3(0.5f, -1.5f, -0.7f); // isto kot v shaderju
-        glm::mat4 view = glm::lookAt(frustumCenter - lightDir * 10.0f, frustumCenter, glm::vec3(0, 1, 0));
+            glm::vec3 center;
+            float radius;
+            CalcCascadeSphere(i, &center, &radius);
 
-        float minX = std::numeric_limits<float>::max();
-        float maxX = std::numeric_limits<float>::lowest();
-        float minY = std::numeric_limits<float>::max();
-        float maxY = std::numeric_limits<float>::lowest();
+            // dokler je potrebna krogla znotraj narisane, shadow map ostane
+            if (cascade.valid == false || glm::length(center - cascade.center) + radius > cascade.radius)
+            {
+                cascade.center = center;
+                cascade.radius = glm::ceil(radius * (1.0f + m_cascadeMargin) * 16.0f) / 16.0f;
+                cascade.viewProj = CalcCascadeViewProj(i, cascade.center, cascade.radius);
+                cascade.valid = true;
+                cascade.hasDirtyRegion = false;
+
+                redraw[i] = true;
+                regions[i] = glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f);
+                m_frameDataDirty = true;
+            }
+            else if (cascade.hasDirtyRegion)
+            {
+                cascade.hasDirtyRegion = false;
 
-        float worldMinX = std::numeric_limits<float>::max();
-        float worldMaxX = std::numeric_limits<float>::lowest();
-        float worldMinZ = std::numeric_limits<float>::max();
-        float worldMaxZ = std::numeric_limits<float>::lowest();
+                glm::vec3 min, max;
+                ProjectToShadowSpace(cascade.viewProj, cascade.dirtyMin, cascade.dirtyMax, &min, &max);
+                glm::vec4 region = glm::clamp(glm::vec4(min.x, min.y, max.x, max.y), glm::vec4(-1.0f), glm::vec4(1.0f));
 
-        for (const auto& c : frustumCorners)
-        {
-            glm::vec4 p = view * glm::vec4(c, 1.0);
+                if (region.x < region.z && region.y < region.w)
+                {
+                    redraw[i] = true;
+                    regions[i] = region;
+                }
+            }
+        }
 
-            minX = glm::min(minX, p.x);
-            maxX = glm::max(maxX, p.x);
-            minY = glm::min(minY, p.y);
-            maxY = glm::max(maxY, p.y);
+        bool anyRedraw = false;
+        for (int i = 0; i < m_numCascades; i++)
+            anyRedraw |= redraw[i];
 
-            worldMinX = glm::min(worldMinX, c.x);
-            worldMaxX = glm::max(worldMaxX, c.x);
-            worldMinZ = glm::min(worldMinZ, c.z);
-            worldMaxZ = glm::max(worldMaxZ, c.z);
-        }
+        if (anyRedraw == false)
+            return;
 
-        glm::mat4 proj = glm::ortho(minX, maxX, minY, maxY, 1.0f, 50.0f);
-        m_shadowViewProj = proj * view;
+        UploadFrameData();
 
+        glBindFramebuffer(GL_FRAMEBUFFER, m_shadowFbo);
+        glEnable(GL_SCISSOR_TEST);
+        glEnable(GL_DEPTH_CLAMP); // casterji pred near planom dobijo globino 0 namesto da se odrezejo
         glUseProgram(m_shadowShaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(m_shadowShaderProgram, "uViewProj"), 1, GL_FALSE, &m_shadowViewProj[0][0]);
 
-        for (int z = 0; z < ChunkManager::width; z++)
+        for (int i = 0; i < m_numCascades; i++)
         {
-            for (int x = 0; x < ChunkManager::width; x++)
-            {
-                glm::vec3 pos = glm::vec3(Chunk::worldWidth * x, 0.0f, Chunk::worldWidth * z);
-                pos.x -= ChunkManager::width / 2 * Chunk::worldWidth;
-                pos.z -= ChunkManager::width / 2 * Chunk::worldWidth;
-                pos += glm::vec3(1.0f / 16.0f / 2.0f);
-                pos += ChunkManager::GetCenterChunkPos();
-
-                if (pos.x + Chunk::worldWidth / 2.0f < worldMinX ||
-                    pos.x - Chunk::worldWidth / 2.0f > worldMaxX ||
-                    pos.z + Chunk::worldWidth / 2.0f < worldMinZ ||
-                    pos.z - Chunk::worldWidth / 2.0f > worldMaxZ)
-                {
-                    continue;
-                }
+            if (redraw[i] == false)
+                continue;
 
-                Chunk* chunk = ChunkManager::GetChunk(x, z);
+            // ndc -> texli v atlasu, en texel roba zaradi zaokrozevanja
+            const glm::ivec4& rect = m_shadowAtlasRects[i];
+            const glm::vec4& region = regions[i];
 
-                glm::mat4 model(1.0f);
-                model = glm::translate(model, pos);
+            int minX = glm::max(rect.x + (int)glm::floor((region.x * 0.5f + 0.5f) * rect.z) - 1, rect.x);
+            int minY = glm::max(rect.y + (int)glm::floor((region.y * 0.5f + 0.5f) * rect.w) - 1, rect.y);
+            int maxX = glm::min(rect.x + (int)glm::ceil((region.z * 0.5f + 0.5f) * rect.z) + 1, rect.x + rect.z);
+            int maxY = glm::min(rect.y + (int)glm::ceil((region.w * 0.5f + 0.5f) * rect.w) + 1, rect.y + rect.w);
 
-                glUniformMatrix4fv(glGetUniformLocation(m_shadowShaderProgram, "uModel"), 1, GL_FALSE, &model[0][0]);
+            glViewport(rect.x, rect.y, rect.z, rect.w);
+            glScissor(minX, minY, maxX - minX, maxY - minY);
+            glClear(GL_DEPTH_BUFFER_BIT);
 
-                glBindVertexArray(chunk->GetVao());
-                glDrawArrays(GL_TRIANGLES, 0, chunk->GetNumVertices());
-            }
+            glUniform1i(m_shadowCascadeLoc, i);
+            DrawShadowCasters(i, region);
+
+            m_shadowStats.cascadesDrawn++;
         }
 
+        glDisable(GL_DEPTH_CLAMP);
+        glDisable(GL_SCISSOR_TEST);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glViewport(0, 0, m_windowSize.x, m_windowSize.y);
     }
 
+    const ShadowStats& GetShadowStats()
+    {
+        return m_shadowStats;
+    }
+
+    void InvalidateShadows(const glm::vec3& min, const glm::vec3& max)
+    {
+        for (auto& cascade : m_cascades)
+        {
+            if (cascade.valid == false)
+                continue;
+
+            if (cascade.hasDirtyRegion)
+            {
+                cascade.dirtyMin = glm::min(cascade.dirtyMin, min);
+                cascade.dirtyMax = glm::max(cascade.dirtyMax, max);
+            }
+            else
+            {
+                cascade.dirtyMin = min;
+                cascade.dirtyMax = max;
+                cascade.hasDirtyRegion = true;
+            }
+        }
+    }
+
     uint32_t LoadShader(std::string_view source, GLenum type)
     {
         const char* data = source.data();
@@ -686,6 +1291,21 @@ namespace voxr
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
 
+        // skupni uniformi in samplerji se nastavijo samo enkrat tukaj
+        uint32_t frameDataIndex = glGetUniformBlockIndex(program, "FrameData");
+        if (frameDataIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, frameDataIndex, m_frameDataBinding);
+
+        glUseProgram(program);
+
+        int shadowMapLoc = glGetUniformLocation(program, "uShadowMap");
+        if (shadowMapLoc != -1)
+            glUniform1i(shadowMapLoc, 0);
+
+        int chunkPositionsLoc = glGetUniformLocation(program, "uChunkPositions");
+        if (chunkPositionsLoc != -1)
+            glUniform1i(chunkPositionsLoc, VertexArena::slotTextureUnit);
+
         return program;
     }
 }
@@ -10,14 +10,31 @@
 #include <glm/ext/matrix_clip_space.hpp>
 #include "Chunk.h"
 #include "FrustumCulling.h"
+#include <vector>
 
 constexpr auto PI = 3.14159265359f;
 
 #define USE_DEBUG_CAMERA 0
 #define RANDOM_SEED 1
+#define USE_VERTEX_ARENA 1 // vsi chunki v enem bufferju, risani z enim glMultiDrawArrays
 
 namespace voxr
 {
+    struct RenderStats
+    {
+        int visibleChunks = 0;
+        uint64_t fragments = 0; // fragmenti glavnega passa chunkov (z zamikom dveh frameov)
+        float overdraw = 0.0f; // fragmenti na piksel okna
+        bool depthPrepass = false;
+    };
+
+    struct ShadowStats
+    {
+        int casters = 0; // narisani chunki v vseh cascadih ta frame
+        int culled = 0; // chunki z geometrijo, ki niso v volumnu luci
+        int cascadesDrawn = 0;
+    };
+
     void CreateWindow(const char* title, int width, int height);
     GLFWwindow* GetWindow();
 
@@ -33,11 +50,24 @@ namespace voxr
     void DrawText(std::string_view text, glm::vec2 pos = glm::vec2(0.0f));
     void DrawTextF(std::string_view format, glm::vec2 pos = glm::vec2(0.0f), ...);
     void DrawChunk(const Chunk& chunk, const glm::vec3& pos);
+    // chunki naj bodo sortirani od blizu proti dalec
+    void DrawChunks(const std::vector<const Chunk*>& chunks);
+
+    // visinsko polje okoli mreze chunkov (FarTerrain, tipka H)
+    void DrawFarTerrain();
+
+    // depth prepass pred glavnim passom (tipka P)
+    void SetDepthPrepass(bool enabled);
+    bool GetDepthPrepass();
+    const RenderStats& GetRenderStats();
+    const glm::mat4& GetViewProj(); // kamera v zadnjem frameu
 
     void DrawLine(const glm::vec3& a, const glm::vec3& b);
     void SubmitDrawLines();
 
     void ShadowPass();
+    void InvalidateShadows(const glm::vec3& min, const glm::vec3& max); // ko se spremeni geometrija v tem obmocju
+    const ShadowStats& GetShadowStats();
 
     uint32_t LoadShader(std::string_view source, GLenum type);
     uint32_t LoadShaderProgram(const char* vertShaderFile, const char* fragShaderFile);